@@ -0,0 +1,203 @@
+/* RF Kill monitor
+ * Copyright 2015 Michael Davidsaver <mdavidsaver@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+
+#include <time.h>
+
+#include <QDebug>
+#include <QHash>
+#include <QtDBus/QDBusMetaType>
+#include <QtDBus/QDBusPendingCallWatcher>
+#include <QtDBus/QDBusPendingReply>
+
+#include "rfmodel.h"
+
+#define SERVICE "foo.rfkill"
+#define TIMEOUT 5000 // ms
+
+RFModel::RFModel(const QDBusConnection& c, QObject *parent)
+    :QObject(parent)
+    ,valid(false)
+    ,reportLatency(false)
+    ,conn(c)
+    ,pending(NULL)
+{
+    // empty path matches signals from all devices
+    if(!conn.connect(SERVICE, QString(), "foo.rfkill.device", "stateChanged",
+                     this, SLOT(stateChanged(int,QDBusMessage))))
+        qWarning("Failed to subscribe to device state changes");
+    // sent before stateChanged by version 3 daemons
+    if(!conn.connect(SERVICE, QString(), "foo.rfkill.device", "stateChangedAt",
+                     this, SLOT(stateChangedAt(int,qlonglong,QDBusMessage))))
+        qWarning("Failed to subscribe to device state change times");
+
+    if(!conn.connect(SERVICE, "/service", "foo.rfkill.service", "adaptersChanged",
+                     this, SLOT(refreshAsync())))
+        qWarning("Failed to subscribe to adapter changes");
+}
+
+RFModel::~RFModel() {}
+
+QDBusMessage RFModel::describeCall() const
+{
+    return QDBusMessage::createMethodCall(SERVICE, "/service",
+                                          "foo.rfkill.service", "describe");
+}
+
+void RFModel::refresh()
+{
+    QDBusPendingReply<QVariantMap> R(conn.asyncCall(describeCall(), TIMEOUT));
+    R.waitForFinished();
+    if(R.isError()) {
+        qDebug()<<"DBus error: "<<R.error();
+        valid = false;
+        throw std::runtime_error("DBus error");
+    }
+    load(R.value());
+}
+
+void RFModel::refreshAsync()
+{
+    if(pending)
+        pending->deleteLater(); // reply to newest request wins
+
+    pending = new QDBusPendingCallWatcher(conn.asyncCall(describeCall(), TIMEOUT), this);
+    connect(pending, SIGNAL(finished(QDBusPendingCallWatcher*)),
+            SLOT(describeDone(QDBusPendingCallWatcher*)));
+}
+
+void RFModel::describeDone(QDBusPendingCallWatcher *W)
+{
+    W->deleteLater();
+    if(W!=pending)
+        return; // superseded
+    pending = NULL;
+
+    QDBusPendingReply<QVariantMap> R(*W);
+    if(R.isError()) {
+        qDebug()<<"DBus error: "<<R.error();
+        valid = false;
+        emit error(R.error().message());
+        return;
+    }
+    load(R.value());
+    emit ready();
+}
+
+void RFModel::load(const QVariantMap& all)
+{
+    devices_t next;
+
+    for(QVariantMap::const_iterator it=all.begin(), end=all.end(); it!=end; ++it)
+    {
+        // nested maps arrive still marshalled
+        QVariantMap info(qdbus_cast<QVariantMap>(it.value()));
+
+        Device dev;
+        dev.path = it.key();
+        dev.name = info["name"].toString();
+        dev.typeName = info["typeName"].toString();
+        dev.type = info["type"].toInt();
+        dev.state = info["state"].toInt();
+        dev.lastChange = info["lastChange"].toLongLong();
+        next.insert(it.key(), dev);
+    }
+
+    bool addrem = !valid || next.keys()!=devices.keys();
+
+    devices.swap(next);
+    valid = true;
+
+    if(addrem)
+        emit devicesChanged();
+    emit changed();
+}
+
+const RFModel::Device* RFModel::findPath(const QString& path) const
+{
+    devices_t::const_iterator it = devices.find(path);
+    return it==devices.end() ? NULL : &it.value();
+}
+
+const RFModel::Device* RFModel::findName(const QString& name) const
+{
+    for(devices_t::const_iterator it=devices.begin(), end=devices.end(); it!=end; ++it)
+    {
+        if(it->name==name)
+            return &it.value();
+    }
+    return NULL;
+}
+
+QStringList RFModel::names() const
+{
+    QStringList ret;
+    foreach(const Device& dev, devices)
+        ret.append(dev.name);
+    return ret;
+}
+
+QMap<QString, QString> RFModel::labels() const
+{
+    QHash<QString, int> count;
+    foreach(const Device& dev, devices)
+        count[dev.name]++;
+
+    QMap<QString, QString> ret;
+    for(devices_t::const_iterator it=devices.begin(), end=devices.end(); it!=end; ++it)
+    {
+        if(count.value(it->name)>1)
+            ret[it.key()] = QString("%1 [%2]").arg(it->name).arg(it.key().section('/', -1));
+        else
+            ret[it.key()] = it->name;
+    }
+    return ret;
+}
+
+void RFModel::stateChanged(int state, const QDBusMessage& msg)
+{
+    update(msg.path(), state, 0);
+}
+
+void RFModel::stateChangedAt(int state, qlonglong stamp, const QDBusMessage& msg)
+{
+    if(reportLatency) {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        qint64 now = qint64(ts.tv_sec)*1000000000 + ts.tv_nsec;
+
+        QDBusMessage rep(QDBusMessage::createMethodCall(SERVICE, "/service",
+                                                        "foo.rfkill.service", "reportLatency"));
+        rep << qlonglong(now-stamp);
+        conn.send(rep); // ignore reply
+    }
+
+    update(msg.path(), state, stamp);
+}
+
+void RFModel::update(const QString& path, int state, qint64 stamp)
+{
+    devices_t::iterator it = devices.find(path);
+    if(it==devices.end() || it->state==state)
+        return; // not loaded yet, or nothing new
+    it->state = state;
+    if(stamp)
+        it->lastChange = stamp;
+    emit deviceStateChanged(path, state);
+    emit changed();
+}
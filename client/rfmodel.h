@@ -0,0 +1,112 @@
+/* RF Kill monitor
+ * Copyright 2015 Michael Davidsaver <mdavidsaver@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef RFMODEL_H
+#define RFMODEL_H
+
+#include <QObject>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+#include <QtDBus/QDBusConnection>
+#include <QtDBus/QDBusMessage>
+
+class QDBusPendingCallWatcher;
+
+//! Client side copy of the state of all foo.rfkill devices.
+//! Filled by one describe() call, then kept up to date
+//! from the stateChanged signal of every device and the
+//! adaptersChanged signal of the service.
+//!
+//! All reads are lookups in 'devices'.
+class RFModel : public QObject
+{
+    Q_OBJECT
+    friend class TestRFModel;
+public:
+    // must match RFDevice::State
+    enum State{Invalid=0,On,Soft,Hard};
+
+    struct Device {
+        Device() :type(0), state(Invalid), lastChange(0) {}
+        QString path; // same as the key in 'devices'
+        QString name, typeName;
+        int type;
+        int state;
+        //! CLOCK_MONOTONIC (ns) when the daemon read the last change.
+        //! Zero if the daemon is too old to say.
+        qint64 lastChange;
+
+        bool active() const{return state==On;}
+    };
+    typedef QMap<QString, Device> devices_t; // keyed by object path
+
+    explicit RFModel(const QDBusConnection&, QObject *parent = 0);
+    virtual ~RFModel();
+
+    //! (re)load all devices, waiting for the reply.  Throws on error
+    void refresh();
+
+    //! device with the given object path, or NULL
+    const Device* findPath(const QString& path) const;
+    //! first device with the given name, or NULL.
+    //! Names need not be unique, so prefer findPath()
+    const Device* findName(const QString&) const;
+    //! names of all devices, ordered by path
+    QStringList names() const;
+    //! Label for each device, keyed by path.  The name, with the last
+    //! part of the path added where two devices have the same name.
+    QMap<QString, QString> labels() const;
+
+    devices_t devices;
+    //! true once loaded, until an error
+    bool valid;
+    //! if set, report how long each state change took to arrive
+    //! back to the daemon
+    bool reportLatency;
+
+    QDBusConnection conn;
+
+public slots:
+    //! (re)load all devices in the background.
+    //! Emits ready() or error() when done.
+    void refreshAsync();
+
+signals:
+    //! anything changed
+    void changed();
+    //! devices were added or removed
+    void devicesChanged();
+    void deviceStateChanged(const QString& path, int state);
+
+    void ready();
+    void error(const QString&);
+
+private slots:
+    void stateChanged(int, const QDBusMessage&);
+    void stateChangedAt(int, qlonglong, const QDBusMessage&);
+    void describeDone(QDBusPendingCallWatcher*);
+
+private:
+    QDBusMessage describeCall() const;
+    void load(const QVariantMap&);
+    void update(const QString& path, int state, qint64 stamp);
+
+    QDBusPendingCallWatcher *pending;
+};
+
+#endif // RFMODEL_H
@@ -0,0 +1,184 @@
+/* RF Kill monitor
+ * Copyright 2015 Michael Davidsaver <mdavidsaver@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* RFModel bookkeeping, without a bus.  describe() replies are
+ * passed to load() directly, and signals to update().
+ */
+
+#include <QtTest/QtTest>
+#include <QtDBus/QDBusPendingCall>
+#include <QtDBus/QDBusPendingCallWatcher>
+
+#include "rfmodel.h"
+
+namespace {
+QVariant describeEntry(const QString& name, int state)
+{
+    QVariantMap info;
+    info["name"] = name;
+    info["type"] = 0;
+    info["typeName"] = QString("Wifi");
+    info["state"] = state;
+    info["lastChange"] = qlonglong(10);
+    return info;
+}
+}
+
+class TestRFModel : public QObject
+{
+    Q_OBJECT
+
+    // never connected, so the constructor's subscriptions fail quietly
+    QDBusConnection conn;
+public:
+    TestRFModel() :conn("rfmodel-test") {}
+
+private slots:
+    void load();
+    void update();
+    void staleReply();
+    void sameName();
+};
+
+void TestRFModel::load()
+{
+    RFModel M(conn);
+    QSignalSpy changed(&M, SIGNAL(changed())),
+               devicesChanged(&M, SIGNAL(devicesChanged()));
+
+    QVariantMap all;
+    all["/devices/phy0_0"] = describeEntry("phy0", RFModel::On);
+    all["/devices/hci0_1"] = describeEntry("hci0", RFModel::Soft);
+
+    QVERIFY(!M.valid);
+    M.load(all);
+    QVERIFY(M.valid);
+    QCOMPARE(M.devices.size(), 2);
+    QCOMPARE(M.devices["/devices/hci0_1"].state, int(RFModel::Soft));
+    QCOMPARE(M.devices["/devices/phy0_0"].lastChange, qint64(10));
+    // first load is always an add
+    QCOMPARE(devicesChanged.count(), 1);
+    QCOMPARE(changed.count(), 1);
+
+    // same devices, new state
+    all["/devices/hci0_1"] = describeEntry("hci0", RFModel::On);
+    M.load(all);
+    QCOMPARE(M.devices["/devices/hci0_1"].state, int(RFModel::On));
+    QCOMPARE(devicesChanged.count(), 1);
+    QCOMPARE(changed.count(), 2);
+
+    // one removed
+    all.remove("/devices/hci0_1");
+    M.load(all);
+    QCOMPARE(M.devices.size(), 1);
+    QCOMPARE(devicesChanged.count(), 2);
+    QCOMPARE(changed.count(), 3);
+}
+
+void TestRFModel::update()
+{
+    RFModel M(conn);
+
+    QVariantMap all;
+    all["/devices/phy0_0"] = describeEntry("phy0", RFModel::On);
+    M.load(all);
+
+    QSignalSpy changed(&M, SIGNAL(changed())),
+               devicesChanged(&M, SIGNAL(devicesChanged())),
+               stateChanged(&M, SIGNAL(deviceStateChanged(QString,int)));
+
+    M.update("/devices/phy0_0", RFModel::Hard, 42);
+    QCOMPARE(M.devices["/devices/phy0_0"].state, int(RFModel::Hard));
+    QCOMPARE(M.devices["/devices/phy0_0"].lastChange, qint64(42));
+    QCOMPARE(stateChanged.count(), 1);
+    QCOMPARE(stateChanged.at(0).at(0).toString(), QString("/devices/phy0_0"));
+    QCOMPARE(stateChanged.at(0).at(1).toInt(), int(RFModel::Hard));
+    QCOMPARE(changed.count(), 1);
+
+    // repeated state is not a change
+    M.update("/devices/phy0_0", RFModel::Hard, 43);
+    QCOMPARE(changed.count(), 1);
+    QCOMPARE(M.devices["/devices/phy0_0"].lastChange, qint64(42));
+
+    // from an old daemon, without a time
+    M.update("/devices/phy0_0", RFModel::On, 0);
+    QCOMPARE(M.devices["/devices/phy0_0"].lastChange, qint64(42));
+    QCOMPARE(changed.count(), 2);
+
+    // not loaded yet
+    M.update("/devices/phy1_2", RFModel::On, 50);
+    QCOMPARE(M.devices.size(), 1);
+    QCOMPARE(changed.count(), 2);
+
+    QCOMPARE(devicesChanged.count(), 0);
+}
+
+void TestRFModel::staleReply()
+{
+    RFModel M(conn);
+
+    QVariantMap all;
+    all["/devices/phy0_0"] = describeEntry("phy0", RFModel::On);
+    M.load(all);
+
+    QSignalSpy error(&M, SIGNAL(error(QString))),
+               ready(&M, SIGNAL(ready()));
+
+    QDBusMessage fail(QDBusMessage::createError("foo.rfkill.Error.Test", "test"));
+    QDBusPendingCallWatcher *older = new QDBusPendingCallWatcher(QDBusPendingCall::fromCompletedCall(fail), &M),
+                            *newer = new QDBusPendingCallWatcher(QDBusPendingCall::fromCompletedCall(fail), &M);
+    // as if refreshAsync() had been called twice
+    M.pending = newer;
+
+    M.describeDone(older);
+    QVERIFY(M.valid);
+    QVERIFY(M.pending==newer);
+    QCOMPARE(error.count(), 0);
+
+    M.describeDone(newer);
+    QVERIFY(!M.valid);
+    QVERIFY(M.pending==NULL);
+    QCOMPARE(error.count(), 1);
+    QCOMPARE(ready.count(), 0);
+}
+
+void TestRFModel::sameName()
+{
+    RFModel M(conn);
+
+    QVariantMap all;
+    all["/devices/hci0_1"] = describeEntry("hci0", RFModel::On);
+    all["/devices/Dell_20Wireless_2"] = describeEntry("Dell Wireless", RFModel::On);
+    all["/devices/Dell_20Wireless_3"] = describeEntry("Dell Wireless", RFModel::Soft);
+    M.load(all);
+
+    QCOMPARE(M.devices.size(), 3);
+    const RFModel::Device *dev = M.findPath("/devices/Dell_20Wireless_3");
+    QVERIFY(dev!=NULL);
+    QCOMPARE(dev->path, QString("/devices/Dell_20Wireless_3"));
+    QCOMPARE(dev->state, int(RFModel::Soft));
+    QVERIFY(M.findPath("/devices/Dell_20Wireless_4")==NULL);
+
+    QMap<QString, QString> labels(M.labels());
+    QCOMPARE(labels.size(), 3);
+    QCOMPARE(labels["/devices/hci0_1"], QString("hci0"));
+    QCOMPARE(labels["/devices/Dell_20Wireless_2"], QString("Dell Wireless [Dell_20Wireless_2]"));
+    QCOMPARE(labels["/devices/Dell_20Wireless_3"], QString("Dell Wireless [Dell_20Wireless_3]"));
+}
+
+QTEST_MAIN(TestRFModel)
+#include "testmodel.moc"
@@ -0,0 +1,135 @@
+/* RF Kill monitor
+ * Copyright 2015 Michael Davidsaver <mdavidsaver@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Time event decoding and device table updates.
+ * test_rfcore checks that what is timed here is correct.
+ */
+
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "rfcore.h"
+#include "rftestutil.h"
+
+namespace {
+
+double now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+// keep results live
+volatile unsigned sink;
+
+void benchDecode()
+{
+    // one read() worth, as in RFManager::readBatch()
+    rfkill_event raw[10];
+    for(unsigned i=0; i<10; i++)
+        raw[i] = mkevent(i, RFKILL_TYPE_WLAN, RFKILL_OP_CHANGE, i&1, 0);
+
+    const unsigned reps = 100000;
+    std::vector<rfkill_event> events;
+
+    double T0 = now();
+    for(unsigned r=0; r<reps; r++) {
+        events.clear();
+        if(!rfcore::decode(reinterpret_cast<const char*>(raw), sizeof(raw), events))
+            abort();
+        for(size_t i=0; i<events.size(); i++)
+            sink += rfcore::eventState(events[i]);
+    }
+    double T1 = now();
+
+    printf("decode          %8.1f ns/event\n", (T1-T0)/(reps*10.0));
+}
+
+void benchChurn(unsigned ndev)
+{
+    CountListener L;
+    rfcore::Table T(L);
+
+    const unsigned reps = 1+100000/ndev;
+
+    double T0 = now();
+    for(unsigned r=0; r<reps; r++) {
+        for(unsigned i=0; i<ndev; i++)
+            T.process(mkevent(i, RFKILL_TYPE_WLAN, RFKILL_OP_ADD, 0, 0), 0);
+        for(unsigned i=0; i<ndev; i++)
+            T.process(mkevent(i, RFKILL_TYPE_WLAN, RFKILL_OP_DEL, 0, 0), 0);
+    }
+    double T1 = now();
+
+    if(L.nadd!=reps*ndev || L.nrem!=reps*ndev || !T.entries.empty())
+        abort();
+
+    printf("add/del  %6u  %8.1f ns/event\n", ndev, (T1-T0)/(reps*2.0*ndev));
+}
+
+void benchChange(unsigned ndev)
+{
+    CountListener L;
+    rfcore::Table T(L);
+    for(unsigned i=0; i<ndev; i++)
+        T.process(mkevent(i, i&1 ? RFKILL_TYPE_BLUETOOTH : RFKILL_TYPE_WLAN, RFKILL_OP_ADD, 0, 0), 0);
+
+    const unsigned reps = 1+100000/ndev;
+
+    // one device at a time
+    double T0 = now();
+    for(unsigned r=0; r<reps; r++) {
+        for(unsigned i=0; i<ndev; i++)
+            T.process(mkevent(i, RFKILL_TYPE_WLAN, RFKILL_OP_CHANGE, r&1, 0), 0);
+    }
+    double T1 = now();
+
+    printf("change   %6u  %8.1f ns/event\n", ndev, (T1-T0)/(reps*double(ndev)));
+
+    // all devices of a type
+    L.nchange = 0;
+    T0 = now();
+    for(unsigned r=0; r<reps; r++)
+        T.process(mkevent(0, RFKILL_TYPE_ALL, RFKILL_OP_CHANGE_ALL, r&1, 0), 0);
+    T1 = now();
+
+    if(L.nchange < (reps-1)*ndev)
+        abort();
+
+    printf("chg_all  %6u  %8.1f ns/event %8.2f ns/device\n", ndev,
+           (T1-T0)/reps, (T1-T0)/(reps*double(ndev)));
+}
+
+} // namespace
+
+int main()
+{
+    benchDecode();
+
+    const unsigned sizes[] = {1, 10, 100, 1000, 10000};
+    for(unsigned i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++)
+        benchChurn(sizes[i]);
+    for(unsigned i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++)
+        benchChange(sizes[i]);
+
+    return 0;
+}
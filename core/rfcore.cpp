@@ -0,0 +1,243 @@
+/* RF Kill monitor
+ * Copyright 2015 Michael Davidsaver <mdavidsaver@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "rfcore.h"
+
+namespace rfcore {
+
+// indexed by enum rfkill_type
+static const char * const typeNames[NKernelTypes] = {
+    "all", "wlan", "bluetooth", "uwb", "wimax", "wwan", "gps", "fm", "nfc",
+};
+
+const char *kernelTypeName(unsigned kernelType)
+{
+    return kernelType<NKernelTypes ? typeNames[kernelType] : NULL;
+}
+
+int kernelType(const char *name)
+{
+    for(unsigned t=0; t<NKernelTypes; t++) {
+        if(strcmp(name, typeNames[t])==0)
+            return t;
+    }
+    return -1;
+}
+
+bool mapType(unsigned kernelType, Type& out)
+{
+    switch(kernelType) {
+    case RFKILL_TYPE_WLAN: out=Wifi; return true;
+    case RFKILL_TYPE_BLUETOOTH: out=Blue; return true;
+    }
+    return false;
+}
+
+bool typeMatches(Type t, unsigned kernelType)
+{
+    if(kernelType==RFKILL_TYPE_ALL)
+        return true;
+    switch(t) {
+    case Wifi: return kernelType==RFKILL_TYPE_WLAN;
+    case Blue: return kernelType==RFKILL_TYPE_BLUETOOTH;
+    }
+    return false;
+}
+
+State eventState(const rfkill_event& evt)
+{
+    if(evt.hard)
+        return Hard;
+    else if(evt.soft)
+        return Soft;
+    else
+        return On;
+}
+
+bool decode(const char *buf, size_t len, std::vector<rfkill_event>& out)
+{
+    if(len%sizeof(rfkill_event)!=0)
+        return false;
+
+    out.reserve(out.size()+len/sizeof(rfkill_event));
+    for(const char *end=buf+len; buf<end; buf+=sizeof(rfkill_event))
+    {
+        punEvent evtbuf;
+        std::copy(buf, buf+sizeof(rfkill_event), evtbuf.bytes);
+        out.push_back(evtbuf.evt);
+    }
+    return true;
+}
+
+std::string deviceName(const std::string& raw, uint32_t idx)
+{
+    std::string ret;
+    bool space = false;
+    for(size_t i=0; i<raw.size(); i++) {
+        if(isspace((unsigned char)raw[i])) {
+            space = true;
+            continue;
+        }
+        if(space && !ret.empty())
+            ret += ' ';
+        space = false;
+        ret += raw[i];
+    }
+
+    if(ret.empty()) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "<device:%u>", (unsigned)idx);
+        ret = buf;
+    }
+    return ret;
+}
+
+std::string objectPath(const std::string& name, uint32_t idx)
+{
+    static const char hex[] = "0123456789ABCDEF";
+
+    std::string ret("/devices/");
+    ret.reserve(ret.size()+3*name.size()+11);
+    for(size_t i=0; i<name.size(); i++) {
+        char c = name[i];
+        if((c>='a' && c<='z') || (c>='A' && c<='Z') || (c>='0' && c<='9')) {
+            ret += c;
+        } else {
+            ret += '_';
+            ret += hex[(unsigned char)c>>4];
+            ret += hex[c&0xf];
+        }
+    }
+
+    char sidx[16];
+    snprintf(sidx, sizeof(sidx), "_%u", (unsigned)idx);
+    ret += sidx;
+    return ret;
+}
+
+LatencyHist::LatencyHist()
+    :count(0)
+    ,maxNs(0)
+{
+    for(unsigned i=0; i<N; i++)
+        buckets[i] = 0;
+}
+
+void LatencyHist::add(int64_t ns)
+{
+    if(ns<0)
+        ns = 0; // clock mismatch?
+    unsigned b=0;
+    while(b<N-1 && (int64_t(1)<<b) < ns)
+        b++;
+    buckets[b]++;
+    count++;
+    if(ns>maxNs)
+        maxNs = ns;
+}
+
+bool isPhyName(const char *name)
+{
+    if(strncmp(name, "phy", 3)!=0 && strncmp(name, "hci", 3)!=0)
+        return false;
+    name += 3;
+    if(*name=='\0')
+        return false;
+    for(; *name; name++) {
+        if(*name<'0' || *name>'9')
+            return false;
+    }
+    return true;
+}
+
+Table::Table(Listener& L)
+    :listener(L)
+{}
+
+void Table::setState(entries_t::iterator it, const rfkill_event& evt, int64_t stamp)
+{
+    State next = eventState(evt);
+    if(it->second.state==next)
+        return;
+    it->second.state = next;
+    listener.changed(it->first, next, stamp);
+}
+
+bool Table::process(const rfkill_event& evt, int64_t stamp)
+{
+    switch(rfkill_operation(evt.op)) {
+    case RFKILL_OP_CHANGE_ALL:{
+        // change all devices of the given type
+        for(entries_t::iterator it=entries.begin(), end=entries.end(); it!=end; ++it) {
+            if(typeMatches(it->second.type, evt.type))
+                setState(it, evt, stamp);
+        }
+    }return false;
+
+    case RFKILL_OP_ADD:{
+        entries_t::iterator it=entries.find(evt.idx);
+        if(it!=entries.end()) {
+            // already known (eg. replayed after re-open, or found by audit)
+            setState(it, evt, stamp);
+            return false;
+        }
+
+        // add a new device
+        Entry ent;
+        if(!mapType(evt.type, ent.type)) {
+            listener.warning("Asked to add device of unsupported type", evt);
+            return false; // ignore device type
+        }
+        ent.state = eventState(evt);
+
+        entries[evt.idx] = ent;
+        listener.added(evt.idx, ent.type, ent.state, stamp);
+    }return true;
+
+    case RFKILL_OP_DEL:{
+        entries_t::iterator it=entries.find(evt.idx);
+        if(it==entries.end()) {
+            listener.warning("Asked to remove unknown device", evt);
+            return false;
+        }
+        entries.erase(it);
+        listener.removed(evt.idx);
+    }return true;
+
+    case RFKILL_OP_CHANGE:{
+        entries_t::iterator it=entries.find(evt.idx);
+        if(it==entries.end()) {
+            listener.warning("Asked to change unknown device", evt);
+        } else {
+            setState(it, evt, stamp);
+        }
+    }return false;
+
+    // default: omitted to trigger compiler warning if rkill_operation enum is extended
+    }
+
+    listener.warning("Unknown operator", evt);
+    return false;
+}
+
+} // namespace rfcore
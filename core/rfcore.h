@@ -0,0 +1,132 @@
+/* RF Kill monitor
+ * Copyright 2015 Michael Davidsaver <mdavidsaver@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef RFCORE_H
+#define RFCORE_H
+
+#include <string>
+#include <vector>
+#include <tr1/unordered_map>
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <linux/rfkill.h>
+
+//! Decoding of /dev/rfkill events, and the table of known devices.
+//! Used by both the Qt and the lite daemon, so no Qt here.
+namespace rfcore {
+
+// values are part of the D-Bus interface
+enum State{Invalid=0,On,Soft,Hard};
+enum Type{Wifi=0, Blue};
+
+//! Map kernel device type.  Returns false if not one we follow.
+bool mapType(unsigned kernelType, Type& out);
+
+//! Does an event for this kernel type apply to a device of our type?
+//! RFKILL_TYPE_ALL matches any.
+bool typeMatches(Type, unsigned kernelType);
+
+State eventState(const rfkill_event&);
+
+//! Number of kernel device types with a name, from RFKILL_TYPE_ALL to RFKILL_TYPE_NFC
+enum {NKernelTypes=9};
+
+//! Name of a kernel device type, as in sysfs (eg. "wlan").
+//! NULL if unknown.
+const char *kernelTypeName(unsigned kernelType);
+
+//! Kernel device type with this name, or -1
+int kernelType(const char *name);
+
+//! Is this the name of a wireless phy or bluetooth controller?  eg. "phy0" or "hci0"
+bool isPhyName(const char *name);
+
+union punEvent {
+    rfkill_event evt;
+    char bytes[sizeof(rfkill_event)];
+};
+
+//! Append events from a buffer read from /dev/rfkill.
+//! Returns false, and appends nothing, if the buffer ends
+//! with a partial event.
+bool decode(const char *buf, size_t len, std::vector<rfkill_event>& out);
+
+//! Device name as exported, from the raw bytes of sysfs 'name'.
+//! Whitespace is trimmed, and each inner run of it becomes one space.
+//! An empty name becomes "<device:idx>".
+std::string deviceName(const std::string& raw, uint32_t idx);
+
+//! D-Bus object path for a device.  eg. "/devices/phy0_5"
+//! 'name' is from deviceName().
+//! Bytes of the name other than [A-Za-z0-9] are escaped as _XX hex,
+//! and the kernel index is appended, so two devices never collide.
+std::string objectPath(const std::string& name, uint32_t idx);
+
+//! Histogram of latencies with power of 2 (ns) buckets
+struct LatencyHist
+{
+    enum {N=36};
+    // buckets[i] counts latencies <= 2**i, except for buckets[N-1],
+    // which counts all those above 2**(N-2) (~17 sec.)
+    uint64_t buckets[N];
+    uint64_t count;
+    int64_t maxNs;
+
+    LatencyHist();
+    void add(int64_t ns);
+};
+
+//! Told about changes to a Table
+class Listener
+{
+public:
+    virtual ~Listener() {}
+    virtual void added(uint32_t idx, Type, State, int64_t stamp) =0;
+    virtual void removed(uint32_t idx) =0;
+    virtual void changed(uint32_t idx, State, int64_t stamp) =0;
+    //! Something odd about this event
+    virtual void warning(const char *msg, const rfkill_event&) {(void)msg;}
+};
+
+//! Known devices, updated by kernel events
+class Table
+{
+public:
+    struct Entry {
+        Type type;
+        State state;
+    };
+    //! by kernel index.  Not ordered.
+    typedef std::tr1::unordered_map<uint32_t, Entry> entries_t;
+    entries_t entries;
+
+    explicit Table(Listener&);
+
+    //! Apply one event.  'stamp' is passed along to the Listener.
+    //! Returns true if a device was added or removed.
+    bool process(const rfkill_event&, int64_t stamp);
+
+private:
+    void setState(entries_t::iterator, const rfkill_event&, int64_t stamp);
+
+    Listener& listener;
+};
+
+} // namespace rfcore
+
+#endif // RFCORE_H
@@ -0,0 +1,50 @@
+/* RF Kill monitor
+ * Copyright 2015 Michael Davidsaver <mdavidsaver@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef RFTESTUTIL_H
+#define RFTESTUTIL_H
+
+#include <string.h>
+
+#include "rfcore.h"
+
+// Helpers shared by test_rfcore and bench_rfkill
+
+//! Counts Listener callbacks
+struct CountListener : public rfcore::Listener
+{
+    unsigned nadd, nrem, nchange, nwarn;
+    CountListener() :nadd(0), nrem(0), nchange(0), nwarn(0) {}
+    virtual void added(uint32_t, rfcore::Type, rfcore::State, int64_t) {nadd++;}
+    virtual void removed(uint32_t) {nrem++;}
+    virtual void changed(uint32_t, rfcore::State, int64_t) {nchange++;}
+    virtual void warning(const char *, const rfkill_event&) {nwarn++;}
+};
+
+//! Build an event as read from /dev/rfkill
+inline rfkill_event mkevent(uint32_t idx, unsigned type, unsigned op, bool soft, bool hard)
+{
+    rfkill_event evt;
+    memset(&evt, 0, sizeof(evt));
+    evt.idx = idx;
+    evt.type = type;
+    evt.op = op;
+    evt.soft = soft;
+    evt.hard = hard;
+    return evt;
+}
+
+#endif // RFTESTUTIL_H
@@ -0,0 +1,255 @@
+/* RF Kill monitor
+ * Copyright 2015 Michael Davidsaver <mdavidsaver@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Checks of rfcore.  Run by ctest.  Exits non-zero on any failure.
+ */
+
+#include <vector>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "rfcore.h"
+#include "rftestutil.h"
+
+namespace {
+
+unsigned nfail;
+
+#define CHECK(COND) do{ if(!(COND)) { \
+    fprintf(stderr, "%s:%d type=%u op=%u: check failed: %s\n", __FILE__, __LINE__, type, op, #COND); \
+    nfail++; } }while(0)
+
+// one wifi (idx 0) and one bluetooth (idx 1), both on
+void populate(rfcore::Table& T)
+{
+    T.process(mkevent(0, RFKILL_TYPE_WLAN, RFKILL_OP_ADD, false, false), 0);
+    T.process(mkevent(1, RFKILL_TYPE_BLUETOOTH, RFKILL_OP_ADD, false, false), 0);
+}
+
+void check()
+{
+    for(unsigned type=0; type<NUM_RFKILL_TYPES; type++) {
+        rfcore::Type ours;
+        bool supported = rfcore::mapType(type, ours);
+
+        for(unsigned op=0; op<=RFKILL_OP_CHANGE_ALL+1; op++) {
+            for(unsigned sh=0; sh<4; sh++) {
+                bool soft = sh&1, hard = sh&2;
+                rfcore::State expect = hard ? rfcore::Hard : soft ? rfcore::Soft : rfcore::On;
+
+                CountListener L;
+                rfcore::Table T(L);
+                populate(T);
+                L.nadd = 0;
+
+                switch(op) {
+                case RFKILL_OP_ADD:{
+                    bool addrem = T.process(mkevent(5, type, op, soft, hard), 1);
+                    CHECK(addrem==supported);
+                    CHECK(L.nadd==unsigned(supported));
+                    CHECK(L.nwarn==unsigned(!supported));
+                    CHECK(T.entries.size()==(supported ? 3u : 2u));
+                    if(supported)
+                        CHECK(T.entries[5].state==expect && T.entries[5].type==ours);
+
+                    // repeated ADD is a change
+                    if(supported) {
+                        bool again = T.process(mkevent(5, type, op, !soft, hard), 1);
+                        CHECK(!again && L.nadd==1 && T.entries.size()==3u);
+                    }
+                }break;
+
+                case RFKILL_OP_DEL:{
+                    bool addrem = T.process(mkevent(0, type, op, soft, hard), 1);
+                    CHECK(addrem && L.nrem==1 && T.entries.size()==1u && T.entries.count(1));
+                    addrem = T.process(mkevent(9, type, op, soft, hard), 1);
+                    CHECK(!addrem && L.nwarn==1 && T.entries.size()==1u);
+                }break;
+
+                case RFKILL_OP_CHANGE:{
+                    bool addrem = T.process(mkevent(1, type, op, soft, hard), 1);
+                    CHECK(!addrem && T.entries[1].state==expect && T.entries[0].state==rfcore::On);
+                    CHECK(L.nchange==unsigned(expect!=rfcore::On));
+                    addrem = T.process(mkevent(9, type, op, soft, hard), 1);
+                    CHECK(!addrem && L.nwarn==1 && T.entries.size()==2u);
+                }break;
+
+                case RFKILL_OP_CHANGE_ALL:{
+                    bool addrem = T.process(mkevent(0, type, op, soft, hard), 1);
+                    bool wifi = type==RFKILL_TYPE_ALL || type==RFKILL_TYPE_WLAN,
+                         blue = type==RFKILL_TYPE_ALL || type==RFKILL_TYPE_BLUETOOTH;
+                    CHECK(!addrem);
+                    CHECK(T.entries[0].state==(wifi ? expect : rfcore::On));
+                    CHECK(T.entries[1].state==(blue ? expect : rfcore::On));
+                    CHECK(L.nchange==(expect==rfcore::On ? 0u : unsigned(wifi)+unsigned(blue)));
+                }break;
+
+                default:{
+                    bool addrem = T.process(mkevent(0, type, op, soft, hard), 1);
+                    CHECK(!addrem && L.nwarn==1 && L.nchange==0 && T.entries.size()==2u);
+                }break;
+                }
+            }
+        }
+    }
+}
+
+#undef CHECK
+
+void checkPaths()
+{
+    const char * const cases[][2] = {
+        {"phy0", "/devices/phy0_3"},
+        {"hci0", "/devices/hci0_3"},
+        {"", "/devices/_3"},
+        {"Intel Wi-Fi", "/devices/Intel_20Wi_2DFi_3"},
+        {"a_b", "/devices/a_5Fb_3"},
+        {"\xc3\xa9", "/devices/_C3_A9_3"},
+    };
+    for(unsigned i=0; i<sizeof(cases)/sizeof(cases[0]); i++) {
+        std::string path(rfcore::objectPath(cases[i][0], 3));
+        if(path!=cases[i][1]) {
+            fprintf(stderr, "objectPath(\"%s\") -> %s expected %s\n", cases[i][0], path.c_str(), cases[i][1]);
+            nfail++;
+        }
+    }
+}
+
+void checkDeviceNames()
+{
+    // raw sysfs bytes, as both daemons now see them
+    const char * const cases[][3] = {
+        {"phy0\n", "phy0", "/devices/phy0_7"},
+        {"  Intel \t Wi-Fi\n", "Intel Wi-Fi", "/devices/Intel_20Wi_2DFi_7"},
+        {"\xc3\xa9\n", "\xc3\xa9", "/devices/_C3_A9_7"},
+        {"\n", "<device:7>", "/devices/_3Cdevice_3A7_3E_7"},
+    };
+    for(unsigned i=0; i<sizeof(cases)/sizeof(cases[0]); i++) {
+        std::string name(rfcore::deviceName(cases[i][0], 7)),
+                    path(rfcore::objectPath(name, 7));
+        if(name!=cases[i][1] || path!=cases[i][2]) {
+            fprintf(stderr, "deviceName(\"%s\") -> \"%s\" %s expected \"%s\" %s\n",
+                    cases[i][0], name.c_str(), path.c_str(), cases[i][1], cases[i][2]);
+            nfail++;
+        }
+    }
+}
+
+void checkDecode()
+{
+    rfkill_event raw[2];
+    raw[0] = mkevent(3, RFKILL_TYPE_WLAN, RFKILL_OP_ADD, 1, 0);
+    raw[1] = mkevent(4, RFKILL_TYPE_BLUETOOTH, RFKILL_OP_CHANGE, 0, 1);
+    const char *buf = reinterpret_cast<const char*>(raw);
+
+    std::vector<rfkill_event> out;
+    if(!rfcore::decode(buf, sizeof(raw), out) || out.size()!=2
+            || out[0].idx!=3 || !out[0].soft || out[1].idx!=4 || !out[1].hard
+            || out[1].op!=RFKILL_OP_CHANGE) {
+        fprintf(stderr, "decode() of two events failed\n");
+        nfail++;
+    }
+
+    // appends to what is already there
+    if(!rfcore::decode(buf, sizeof(rfkill_event), out) || out.size()!=3 || out[2].idx!=3) {
+        fprintf(stderr, "decode() didn't append\n");
+        nfail++;
+    }
+
+    if(!rfcore::decode(buf, 0, out) || out.size()!=3) {
+        fprintf(stderr, "decode() of empty buffer failed\n");
+        nfail++;
+    }
+
+    // partial event, alone and after whole ones
+    const size_t partial[] = {1, sizeof(rfkill_event)-1, sizeof(rfkill_event)+1, sizeof(raw)-1};
+    for(unsigned i=0; i<sizeof(partial)/sizeof(partial[0]); i++) {
+        if(rfcore::decode(buf, partial[i], out) || out.size()!=3) {
+            fprintf(stderr, "decode() accepted partial buffer of %u bytes\n", (unsigned)partial[i]);
+            nfail++;
+        }
+    }
+}
+
+void checkNames()
+{
+    for(unsigned t=0; t<rfcore::NKernelTypes; t++) {
+        const char *name = rfcore::kernelTypeName(t);
+        if(!name || rfcore::kernelType(name)!=int(t)) {
+            fprintf(stderr, "kernel type %u name doesn't round trip\n", t);
+            nfail++;
+        }
+    }
+    if(rfcore::kernelTypeName(rfcore::NKernelTypes) || rfcore::kernelType("bogus")!=-1) {
+        fprintf(stderr, "unknown kernel type accepted\n");
+        nfail++;
+    }
+
+    const char * const phys[] = {"phy0", "hci12"},
+               * const notphys[] = {"phy", "hci", "phy0a", "thinkpad_acpi", "ideapad_acpi", ""};
+    for(unsigned i=0; i<sizeof(phys)/sizeof(phys[0]); i++) {
+        if(!rfcore::isPhyName(phys[i])) {
+            fprintf(stderr, "isPhyName(\"%s\") false\n", phys[i]);
+            nfail++;
+        }
+    }
+    for(unsigned i=0; i<sizeof(notphys)/sizeof(notphys[0]); i++) {
+        if(rfcore::isPhyName(notphys[i])) {
+            fprintf(stderr, "isPhyName(\"%s\") true\n", notphys[i]);
+            nfail++;
+        }
+    }
+}
+
+void checkHist()
+{
+    rfcore::LatencyHist H;
+    H.add(-5); // as 0
+    H.add(1);
+    H.add(2);
+    H.add(3);
+    H.add(int64_t(1)<<(H.N-2));
+    H.add((int64_t(1)<<(H.N-2))+1);
+    H.add(int64_t(1)<<40);
+
+    if(H.count!=7 || H.maxNs!=int64_t(1)<<40
+            || H.buckets[0]!=2 || H.buckets[1]!=1 || H.buckets[2]!=1
+            || H.buckets[H.N-2]!=1 || H.buckets[H.N-1]!=2) {
+        fprintf(stderr, "LatencyHist buckets wrong\n");
+        nfail++;
+    }
+}
+
+} // namespace
+
+int main()
+{
+    check();
+    checkPaths();
+    checkDeviceNames();
+    checkDecode();
+    checkNames();
+    checkHist();
+
+    if(nfail) {
+        fprintf(stderr, "%u checks failed\n", nfail);
+        return 1;
+    }
+    printf("All checks pass\n");
+    return 0;
+}
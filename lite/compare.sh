@@ -0,0 +1,29 @@
+#!/bin/sh
+# Compare startup time and resident memory of the Qt and lite daemons.
+# Each runs on a private session bus.
+#
+# usage: compare.sh <cmake build directory>
+set -e
+
+B="${1:-.}"
+
+for D in "$B/service/rfkilldaemon" "$B/lite/rfkilldaemon-lite"
+do
+    [ -x "$D" ] || { echo "$D not built"; continue; }
+    dbus-run-session -- sh -c '
+        T0=$(date +%s%N)
+        "$0" &
+        P=$!
+        until dbus-send --session --print-reply --dest=foo.rfkill /service foo.rfkill.service.version >/dev/null 2>&1
+        do
+            sleep 0.01
+        done
+        T1=$(date +%s%N)
+        # let the first /dev/rfkill events be processed
+        sleep 2
+        echo "$0"
+        echo "  ready in $(( (T1-T0)/1000000 )) ms"
+        echo "  $(grep VmRSS /proc/$P/status)"
+        kill $P
+    ' "$D"
+done
@@ -0,0 +1,638 @@
+/* RF Kill monitor
+ * Copyright 2015 Michael Davidsaver <mdavidsaver@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <time.h>
+#include <stdlib.h>
+
+#include "rfkilld.h"
+
+#define DEVRFKILL "/dev/rfkill"
+#define SYSRFKILL "/sys/class/rfkill"
+
+// must match RFDevice::Proxy::typeNames() and stateNames()
+static const char * const typeNames[] = {"Wifi", "Bluetooth"};
+
+namespace {
+
+void fail(const char *what, int err)
+{
+    std::ostringstream strm;
+    strm<<what<<": "<<strerror(err);
+    throw std::runtime_error(strm.str());
+}
+
+/* foo.rfkill.device */
+
+#define DEV(USERDATA) static_cast<LiteDaemon::Device*>(USERDATA)
+
+int devName(sd_bus *, const char *, const char *, const char *,
+            sd_bus_message *reply, void *userdata, sd_bus_error *)
+{ return sd_bus_message_append(reply, "s", DEV(userdata)->name.c_str()); }
+
+int devType(sd_bus *, const char *, const char *, const char *,
+            sd_bus_message *reply, void *userdata, sd_bus_error *)
+{ return sd_bus_message_append(reply, "i", int(DEV(userdata)->type)); }
+
+int devActive(sd_bus *, const char *, const char *, const char *,
+              sd_bus_message *reply, void *userdata, sd_bus_error *)
+{ return sd_bus_message_append(reply, "b", int(DEV(userdata)->state==rfcore::On)); }
+
+int devState(sd_bus *, const char *, const char *, const char *,
+             sd_bus_message *reply, void *userdata, sd_bus_error *)
+{ return sd_bus_message_append(reply, "i", int(DEV(userdata)->state)); }
+
+int devLastChange(sd_bus *, const char *, const char *, const char *,
+                  sd_bus_message *reply, void *userdata, sd_bus_error *)
+{ return sd_bus_message_append(reply, "x", DEV(userdata)->lastChange); }
+
+// same as RFMetaCache::load(), but not cached
+
+int devPersistent(sd_bus *, const char *, const char *, const char *,
+                  sd_bus_message *reply, void *userdata, sd_bus_error *)
+{
+    const LiteDaemon::Device *dev = DEV(userdata);
+    std::string val(dev->owner->attr(dev->idx, "persistent"));
+    return sd_bus_message_append(reply, "b", int(strtoul(val.c_str(), NULL, 10)!=0));
+}
+
+int devPhy(sd_bus *, const char *, const char *, const char *,
+           sd_bus_message *reply, void *userdata, sd_bus_error *)
+{
+    const LiteDaemon::Device *dev = DEV(userdata);
+    std::string val(dev->owner->link(dev->idx, "device"));
+    if(!rfcore::isPhyName(val.c_str()))
+        val.clear();
+    return sd_bus_message_append(reply, "s", val.c_str());
+}
+
+int devDriver(sd_bus *, const char *, const char *, const char *,
+              sd_bus_message *reply, void *userdata, sd_bus_error *)
+{
+    const LiteDaemon::Device *dev = DEV(userdata);
+    std::string val, path("device");
+    for(unsigned depth=0; depth<4 && val.empty(); depth++) {
+        val = dev->owner->link(dev->idx, (path+"/driver").c_str());
+        path += "/device";
+    }
+    return sd_bus_message_append(reply, "s", val.c_str());
+}
+
+int devHardReasons(sd_bus *, const char *, const char *, const char *,
+                   sd_bus_message *reply, void *userdata, sd_bus_error *)
+{
+    const LiteDaemon::Device *dev = DEV(userdata);
+    std::string val(dev->owner->attr(dev->idx, "hard_block_reasons"));
+    return sd_bus_message_append(reply, "u", uint32_t(strtoul(val.c_str(), NULL, 0)));
+}
+
+int devTypeNames(sd_bus_message *m, void *, sd_bus_error *)
+{ return sd_bus_reply_method_return(m, "as", 2, typeNames[0], typeNames[1]); }
+
+int devStateNames(sd_bus_message *m, void *, sd_bus_error *)
+{ return sd_bus_reply_method_return(m, "as", 4, "Invalid", "On", "Soft", "Hard"); }
+
+#undef DEV
+
+const sd_bus_vtable deviceVtable[] = {
+    SD_BUS_VTABLE_START(0),
+    SD_BUS_PROPERTY("name", "s", devName, 0, SD_BUS_VTABLE_PROPERTY_CONST),
+    SD_BUS_PROPERTY("type", "i", devType, 0, SD_BUS_VTABLE_PROPERTY_CONST),
+    SD_BUS_PROPERTY("active", "b", devActive, 0, 0),
+    SD_BUS_PROPERTY("state", "i", devState, 0, 0),
+    SD_BUS_PROPERTY("lastChangeTime", "x", devLastChange, 0, 0),
+    SD_BUS_PROPERTY("persistent", "b", devPersistent, 0, 0),
+    SD_BUS_PROPERTY("phy", "s", devPhy, 0, 0),
+    SD_BUS_PROPERTY("driver", "s", devDriver, 0, 0),
+    SD_BUS_PROPERTY("hardReasons", "u", devHardReasons, 0, 0),
+    SD_BUS_METHOD("typeNames", "", "as", devTypeNames, SD_BUS_VTABLE_UNPRIVILEGED),
+    SD_BUS_METHOD("stateNames", "", "as", devStateNames, SD_BUS_VTABLE_UNPRIVILEGED),
+    SD_BUS_SIGNAL("activeChanged", "b", 0),
+    SD_BUS_SIGNAL("stateChanged", "i", 0),
+    SD_BUS_SIGNAL("stateChangedAt", "ix", 0),
+    SD_BUS_VTABLE_END
+};
+
+// One fallback vtable serves every device, instead of a slot each.
+int devFind(sd_bus *, const char *path, const char *, void *userdata,
+            void **found, sd_bus_error *)
+{
+    const LiteDaemon *self = static_cast<const LiteDaemon*>(userdata);
+    LiteDaemon::paths_t::const_iterator it = self->devicesByPath.find(path);
+    if(it==self->devicesByPath.end())
+        return 0;
+    *found = it->second;
+    return 1;
+}
+
+// for introspection of /devices
+int devEnumerate(sd_bus *, const char *, void *userdata, char ***nodes, sd_bus_error *)
+{
+    const LiteDaemon *self = static_cast<const LiteDaemon*>(userdata);
+    char **list = (char**)calloc(self->devicesByPath.size()+1, sizeof(char*));
+    if(!list)
+        return -ENOMEM;
+    size_t n = 0;
+    for(LiteDaemon::paths_t::const_iterator it=self->devicesByPath.begin(), end=self->devicesByPath.end();
+        it!=end; ++it)
+    {
+        if(!(list[n] = strdup(it->first.c_str()))) {
+            while(n)
+                free(list[--n]);
+            free(list);
+            return -ENOMEM;
+        }
+        n++;
+    }
+    *nodes = list;
+    return 0;
+}
+
+/* foo.rfkill.service */
+
+#define SELF(USERDATA) static_cast<LiteDaemon*>(USERDATA)
+
+int svcVersion(sd_bus_message *m, void *, sd_bus_error *)
+{ return sd_bus_reply_method_return(m, "i", 4); }
+
+int svcAdapters(sd_bus_message *m, void *userdata, sd_bus_error *)
+{
+    LiteDaemon *self = SELF(userdata);
+
+    // in index order, as RFManager::Proxy::adapters()
+    std::vector<uint32_t> idxs;
+    idxs.reserve(self->devices.size());
+    for(LiteDaemon::devices_t::const_iterator it=self->devices.begin(), end=self->devices.end();
+        it!=end; ++it)
+        idxs.push_back(it->first);
+    std::sort(idxs.begin(), idxs.end());
+
+    sd_bus_message *reply = NULL;
+    int r = sd_bus_message_new_method_return(m, &reply);
+    if(r>=0)
+        r = sd_bus_message_open_container(reply, 'a', "o");
+    for(size_t i=0; r>=0 && i<idxs.size(); i++)
+        r = sd_bus_message_append(reply, "o", self->devices[idxs[i]]->path.c_str());
+    if(r>=0)
+        r = sd_bus_message_close_container(reply);
+    if(r>=0)
+        r = sd_bus_send(NULL, reply, NULL);
+    sd_bus_message_unref(reply);
+    return r;
+}
+
+int svcFind(sd_bus_message *m, void *userdata, sd_bus_error *)
+{
+    LiteDaemon *self = SELF(userdata);
+    const char *name;
+    int r = sd_bus_message_read(m, "s", &name);
+    if(r<0)
+        return r;
+
+    std::pair<LiteDaemon::names_t::const_iterator, LiteDaemon::names_t::const_iterator>
+            range(self->devicesByName.equal_range(name));
+
+    sd_bus_message *reply = NULL;
+    r = sd_bus_message_new_method_return(m, &reply);
+    if(r>=0)
+        r = sd_bus_message_open_container(reply, 'a', "o");
+    for(; r>=0 && range.first!=range.second; ++range.first)
+        r = sd_bus_message_append(reply, "o", range.first->second->path.c_str());
+    if(r>=0)
+        r = sd_bus_message_close_container(reply);
+    if(r>=0)
+        r = sd_bus_send(NULL, reply, NULL);
+    sd_bus_message_unref(reply);
+    return r;
+}
+
+int svcDescribe(sd_bus_message *m, void *userdata, sd_bus_error *)
+{
+    LiteDaemon *self = SELF(userdata);
+    sd_bus_message *reply = NULL;
+    int r = sd_bus_message_new_method_return(m, &reply);
+    if(r>=0)
+        r = sd_bus_message_open_container(reply, 'a', "{sv}");
+    for(LiteDaemon::devices_t::const_iterator it=self->devices.begin(), end=self->devices.end();
+        r>=0 && it!=end; ++it)
+    {
+        const LiteDaemon::Device& dev = *it->second;
+        // same layout as RFManager::Proxy::describe()
+        if(r>=0) r = sd_bus_message_open_container(reply, 'e', "sv");
+        if(r>=0) r = sd_bus_message_append(reply, "s", dev.path.c_str());
+        if(r>=0) r = sd_bus_message_open_container(reply, 'v', "a{sv}");
+        if(r>=0) r = sd_bus_message_append(reply, "a{sv}", 5,
+                                           "name", "s", dev.name.c_str(),
+                                           "type", "i", int(dev.type),
+                                           "typeName", "s", typeNames[dev.type],
+                                           "state", "i", int(dev.state),
+                                           "lastChange", "x", dev.lastChange);
+        if(r>=0) r = sd_bus_message_close_container(reply);
+        if(r>=0) r = sd_bus_message_close_container(reply);
+    }
+    if(r>=0)
+        r = sd_bus_message_close_container(reply);
+    if(r>=0)
+        r = sd_bus_send(NULL, reply, NULL);
+    sd_bus_message_unref(reply);
+    return r;
+}
+
+// no sysfs audit or rules here
+int svcNotSupported(sd_bus_message *, void *, sd_bus_error *error)
+{ return sd_bus_error_set(error, SD_BUS_ERROR_NOT_SUPPORTED, "Not supported by rfkilldaemon-lite"); }
+
+// same keys as latencyStats() in service/rfservice.cpp
+int appendHist(sd_bus_message *reply, const char *prefix, const rfcore::LatencyHist& H)
+{
+    char key[64];
+    snprintf(key, sizeof(key), "%s:count", prefix);
+    int r = sd_bus_message_append(reply, "{sv}", key, "t", H.count);
+    snprintf(key, sizeof(key), "%s:maxNs", prefix);
+    if(r>=0) r = sd_bus_message_append(reply, "{sv}", key, "x", H.maxNs);
+    for(unsigned i=0; r>=0 && i<H.N; i++) {
+        if(!H.buckets[i])
+            continue;
+        else if(i==H.N-1)
+            snprintf(key, sizeof(key), "%s:overflow", prefix);
+        else
+            snprintf(key, sizeof(key), "%s:le%lld", prefix, (long long)(int64_t(1)<<i));
+        r = sd_bus_message_append(reply, "{sv}", key, "t", H.buckets[i]);
+    }
+    return r;
+}
+
+int svcStats(sd_bus_message *m, void *userdata, sd_bus_error *)
+{
+    LiteDaemon *self = SELF(userdata);
+    sd_bus_message *reply = NULL;
+    int r = sd_bus_message_new_method_return(m, &reply);
+    if(r>=0)
+        r = sd_bus_message_open_container(reply, 'a', "{sv}");
+    if(r>=0)
+        r = sd_bus_message_append(reply, "{sv}", "open", "b", int(self->rfd!=-1));
+    if(r>=0)
+        r = sd_bus_message_append(reply, "{sv}", "events", "t", self->nEvents);
+    if(r>=0)
+        r = appendHist(reply, "daemonLatency", self->daemonLatency);
+    if(r>=0)
+        r = appendHist(reply, "deliveryLatency", self->deliveryLatency);
+    if(r>=0)
+        r = sd_bus_message_close_container(reply);
+    if(r>=0)
+        r = sd_bus_send(NULL, reply, NULL);
+    sd_bus_message_unref(reply);
+    return r;
+}
+
+int svcReportLatency(sd_bus_message *m, void *userdata, sd_bus_error *)
+{
+    LiteDaemon *self = SELF(userdata);
+    int64_t ns;
+    int r = sd_bus_message_read(m, "x", &ns);
+    if(r<0)
+        return r;
+    self->deliveryLatency.add(ns);
+    return sd_bus_reply_method_return(m, "");
+}
+
+#undef SELF
+
+const sd_bus_vtable serviceVtable[] = {
+    SD_BUS_VTABLE_START(0),
+    SD_BUS_METHOD("version", "", "i", svcVersion, SD_BUS_VTABLE_UNPRIVILEGED),
+    SD_BUS_METHOD("adapters", "", "ao", svcAdapters, SD_BUS_VTABLE_UNPRIVILEGED),
+    SD_BUS_METHOD("find", "s", "ao", svcFind, SD_BUS_VTABLE_UNPRIVILEGED),
+    SD_BUS_METHOD("describe", "", "a{sv}", svcDescribe, SD_BUS_VTABLE_UNPRIVILEGED),
+    SD_BUS_METHOD("audit", "", "u", svcNotSupported, SD_BUS_VTABLE_UNPRIVILEGED),
+    SD_BUS_METHOD("reloadRules", "", "b", svcNotSupported, SD_BUS_VTABLE_UNPRIVILEGED),
+    SD_BUS_METHOD("stats", "", "a{sv}", svcStats, SD_BUS_VTABLE_UNPRIVILEGED),
+    SD_BUS_METHOD("reportLatency", "x", "", svcReportLatency,
+                  SD_BUS_VTABLE_UNPRIVILEGED|SD_BUS_VTABLE_METHOD_NO_REPLY),
+    SD_BUS_SIGNAL("adaptersChanged", "", 0),
+    SD_BUS_VTABLE_END
+};
+
+} // namespace
+
+LiteDaemon::LiteDaemon()
+    :table(*this)
+    ,bus(NULL)
+    ,serviceSlot(NULL)
+    ,deviceSlot(NULL)
+    ,enumSlot(NULL)
+    ,sysfd(-1)
+    ,rfd(-1)
+    ,epfd(-1)
+    ,retryAt(0)
+    ,nEvents(0)
+{
+    int r = sd_bus_open_user(&bus);
+    if(r<0)
+        fail("Failed to connect to session bus", -r);
+
+    r = sd_bus_add_object_vtable(bus, &serviceSlot, "/service", "foo.rfkill.service",
+                                 serviceVtable, this);
+    if(r<0)
+        fail("Failed to register main DBus object", -r);
+
+    r = sd_bus_add_fallback_vtable(bus, &deviceSlot, "/devices", "foo.rfkill.device",
+                                   deviceVtable, devFind, this);
+    if(r>=0)
+        r = sd_bus_add_node_enumerator(bus, &enumSlot, "/devices", devEnumerate, this);
+    if(r<0)
+        fail("Failed to register device DBus objects", -r);
+
+    r = sd_bus_request_name(bus, "foo.rfkill", 0);
+    if(r<0)
+        fail("Failed to register service", -r);
+
+    sysfd = ::open(SYSRFKILL, O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+    if(sysfd==-1)
+        fprintf(stderr, "Failed to open " SYSRFKILL ": %s\n", strerror(errno));
+
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if(epfd==-1)
+        fail("epoll_create1", errno);
+
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = sd_bus_get_fd(bus);
+    if(epoll_ctl(epfd, EPOLL_CTL_ADD, ev.data.fd, &ev))
+        fail("epoll_ctl", errno);
+
+    // like RFManager, wait a moment before opening
+    retryAt = now() + 1000000000LL;
+}
+
+LiteDaemon::~LiteDaemon()
+{
+    for(devices_t::iterator it=devices.begin(), end=devices.end(); it!=end; ++it)
+        delete it->second;
+    if(rfd!=-1)
+        ::close(rfd);
+    if(epfd!=-1)
+        ::close(epfd);
+    if(sysfd!=-1)
+        ::close(sysfd);
+    sd_bus_slot_unref(enumSlot);
+    sd_bus_slot_unref(deviceSlot);
+    sd_bus_slot_unref(serviceSlot);
+    sd_bus_flush_close_unref(bus);
+}
+
+int64_t LiteDaemon::now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return int64_t(ts.tv_sec)*1000000000 + ts.tv_nsec;
+}
+
+int LiteDaemon::run()
+{
+    const int busfd = sd_bus_get_fd(bus);
+
+    while(true) {
+        int r;
+        while((r=sd_bus_process(bus, NULL))>0) {}
+        if(r<0) {
+            fprintf(stderr, "D-Bus error: %s\n", strerror(-r));
+            return 1;
+        }
+
+        if(rfd==-1 && now()>=retryAt)
+            openRF();
+
+        // wait for whatever sd-bus is waiting for
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = sd_bus_get_events(bus);
+        ev.data.fd = busfd;
+        if(epoll_ctl(epfd, EPOLL_CTL_MOD, busfd, &ev))
+            fail("epoll_ctl", errno);
+
+        int64_t until = -1; // CLOCK_MONOTONIC ns
+        uint64_t usec;
+        if(sd_bus_get_timeout(bus, &usec)>=0 && usec!=uint64_t(-1))
+            until = int64_t(usec)*1000;
+        if(rfd==-1 && (until<0 || retryAt<until))
+            until = retryAt;
+
+        int timeout = -1; // ms
+        if(until>=0) {
+            int64_t delta = (until-now()+999999)/1000000;
+            timeout = delta<0 ? 0 : delta>60000 ? 60000 : int(delta);
+        }
+
+        epoll_event evts[4];
+        int n = epoll_wait(epfd, evts, 4, timeout);
+        if(n<0 && errno!=EINTR)
+            fail("epoll_wait", errno);
+
+        for(int i=0; i<n; i++) {
+            if(rfd!=-1 && evts[i].data.fd==rfd)
+                readRF();
+            // bus fd is handled by sd_bus_process() at the top
+        }
+    }
+}
+
+void LiteDaemon::openRF()
+{
+    rfd = ::open(DEVRFKILL, O_RDONLY|O_NONBLOCK|O_CLOEXEC);
+    if(rfd==-1) {
+        fprintf(stderr, "Failed to open " DEVRFKILL ": %s\n", strerror(errno));
+        onError();
+        return;
+    }
+
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = rfd;
+    if(epoll_ctl(epfd, EPOLL_CTL_ADD, rfd, &ev)) {
+        fprintf(stderr, "epoll_ctl: %s\n", strerror(errno));
+        onError();
+    }
+}
+
+void LiteDaemon::onError()
+{
+    if(rfd!=-1) {
+        ::close(rfd); // also removes from epoll set
+        rfd = -1;
+    }
+    retryAt = now() + 60000000000LL;
+}
+
+void LiteDaemon::readRF()
+{
+    char buf[10*sizeof(rfkill_event)];
+    ssize_t n = ::read(rfd, buf, sizeof(buf));
+    int64_t stamp = now();
+
+    if(n==0 || (n==-1 && (errno==EWOULDBLOCK || errno==EAGAIN))) {
+        return;
+    } else if(n==-1) {
+        fprintf(stderr, "Failed to read: %s\n", strerror(errno));
+        onError();
+        return;
+    }
+
+    events.clear();
+    if(!rfcore::decode(buf, n, events)) {
+        fprintf(stderr, "Read returned partial event?\n");
+        onError();
+        return;
+    }
+
+    bool addrem = false;
+    for(size_t i=0; i<events.size(); i++) {
+        nEvents++;
+        if(table.process(events[i], stamp))
+            addrem = true;
+    }
+
+    if(addrem)
+        sd_bus_emit_signal(bus, "/service", "foo.rfkill.service", "adaptersChanged", "");
+
+    if(!events.empty())
+        daemonLatency.add(now()-stamp);
+}
+
+std::string LiteDaemon::attr(uint32_t idx, const char *name) const
+{
+    char path[64];
+    snprintf(path, sizeof(path), "rfkill%u/%s", (unsigned)idx, name);
+
+    std::string ret;
+    int fd = sysfd==-1 ? -1 : ::openat(sysfd, path, O_RDONLY|O_CLOEXEC);
+    if(fd!=-1) {
+        char buf[128];
+        ssize_t n = ::pread(fd, buf, sizeof(buf), 0);
+        ::close(fd);
+        while(n>0 && (buf[n-1]=='\n' || buf[n-1]==' '))
+            n--;
+        if(n>0)
+            ret.assign(buf, n);
+    }
+    return ret;
+}
+
+std::string LiteDaemon::link(uint32_t idx, const char *name) const
+{
+    char path[64];
+    snprintf(path, sizeof(path), "rfkill%u/%s", (unsigned)idx, name);
+
+    char buf[256];
+    ssize_t n = sysfd==-1 ? -1 : ::readlinkat(sysfd, path, buf, sizeof(buf));
+    if(n<=0 || size_t(n)==sizeof(buf))
+        return std::string();
+
+    std::string ret(buf, n);
+    size_t sep = ret.rfind('/');
+    if(sep!=ret.npos)
+        ret.erase(0, sep+1);
+    return ret;
+}
+
+std::string LiteDaemon::fetchName(uint32_t idx) const
+{
+    return rfcore::deviceName(attr(idx, "name"), idx);
+}
+
+void LiteDaemon::added(uint32_t idx, rfcore::Type t, rfcore::State s, int64_t stamp)
+{
+    Device *dev = new Device;
+    dev->idx = idx;
+    dev->name = fetchName(idx);
+    dev->path = rfcore::objectPath(dev->name, idx);
+    dev->type = t;
+    dev->state = s;
+    dev->lastChange = stamp;
+    dev->owner = this;
+
+    devices[idx] = dev;
+    devicesByName.insert(std::make_pair(dev->name, dev));
+    devicesByPath[dev->path] = dev;
+
+    // as RFDevice::setState() does going from Invalid
+    if(s!=rfcore::Invalid) {
+        const char *path = dev->path.c_str();
+        sd_bus_emit_signal(bus, path, "foo.rfkill.device", "stateChangedAt", "ix", int(s), stamp);
+        sd_bus_emit_signal(bus, path, "foo.rfkill.device", "stateChanged", "i", int(s));
+        if(s==rfcore::On)
+            sd_bus_emit_signal(bus, path, "foo.rfkill.device", "activeChanged", "b", 1);
+    }
+}
+
+void LiteDaemon::removed(uint32_t idx)
+{
+    devices_t::iterator it = devices.find(idx);
+    if(it==devices.end())
+        return;
+
+    std::pair<names_t::iterator, names_t::iterator> range(devicesByName.equal_range(it->second->name));
+    for(; range.first!=range.second; ++range.first) {
+        if(range.first->second==it->second) {
+            devicesByName.erase(range.first);
+            break;
+        }
+    }
+
+    devicesByPath.erase(it->second->path);
+    delete it->second;
+    devices.erase(it);
+}
+
+void LiteDaemon::changed(uint32_t idx, rfcore::State s, int64_t stamp)
+{
+    devices_t::iterator it = devices.find(idx);
+    if(it==devices.end())
+        return;
+    Device& dev = *it->second;
+
+    bool wason = dev.state==rfcore::On,
+         nowon = s==rfcore::On;
+    dev.state = s;
+    dev.lastChange = stamp;
+
+    // same order as RFDevice::setState()
+    const char *path = dev.path.c_str();
+    sd_bus_emit_signal(bus, path, "foo.rfkill.device", "stateChangedAt", "ix", int(s), stamp);
+    sd_bus_emit_signal(bus, path, "foo.rfkill.device", "stateChanged", "i", int(s));
+    if(wason ^ nowon)
+        sd_bus_emit_signal(bus, path, "foo.rfkill.device", "activeChanged", "b", int(nowon));
+}
+
+void LiteDaemon::warning(const char *msg, const rfkill_event& evt)
+{
+    fprintf(stderr, "%s: idx=%u type=%u op=%u\n", msg,
+            (unsigned)evt.idx, (unsigned)evt.type, (unsigned)evt.op);
+}
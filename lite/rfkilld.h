@@ -0,0 +1,98 @@
+/* RF Kill monitor
+ * Copyright 2015 Michael Davidsaver <mdavidsaver@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef RFKILLD_H
+#define RFKILLD_H
+
+#include <string>
+#include <vector>
+#include <tr1/unordered_map>
+
+#include <systemd/sd-bus.h>
+
+#include "rfcore.h"
+
+//! Qt-free daemon.  Exports the same foo.rfkill.service and
+//! foo.rfkill.device interfaces as RFManager and RFDevice,
+//! using sd-bus and an epoll() loop.
+class LiteDaemon : public rfcore::Listener
+{
+public:
+    LiteDaemon();
+    virtual ~LiteDaemon();
+
+    //! Process events until an error.  Returns exit code.
+    int run();
+
+    struct Device {
+        uint32_t idx;
+        std::string name, path;
+        rfcore::Type type;
+        rfcore::State state;
+        int64_t lastChange; // CLOCK_MONOTONIC ns
+        const LiteDaemon *owner;
+    };
+    //! by kernel index.  Not ordered.
+    typedef std::tr1::unordered_map<uint32_t, Device*> devices_t;
+    devices_t devices;
+    //! index of 'devices' for find()
+    typedef std::tr1::unordered_multimap<std::string, Device*> names_t;
+    names_t devicesByName;
+    //! index of 'devices' for the /devices fallback vtable
+    typedef std::tr1::unordered_map<std::string, Device*> paths_t;
+    paths_t devicesByPath;
+
+    rfcore::Table table;
+
+    sd_bus *bus;
+    sd_bus_slot *serviceSlot;
+    sd_bus_slot *deviceSlot, *enumSlot; // all of /devices/*
+    int sysfd;  // /sys/class/rfkill
+    int rfd;    // /dev/rfkill
+    int epfd;
+    int64_t retryAt; // when to re-open /dev/rfkill
+    std::vector<rfkill_event> events; // reused by readRF()
+
+    uint64_t nEvents;
+    // same as RFManager
+    rfcore::LatencyHist daemonLatency, deliveryLatency;
+
+    static int64_t now();
+
+    //! Read attribute 'rfkill<idx>/<name>', less trailing whitespace.
+    //! Empty if it can't be read.
+    std::string attr(uint32_t idx, const char *name) const;
+    //! Last component of the target of symlink 'rfkill<idx>/<name>'.
+    //! Empty if there is no such link.
+    std::string link(uint32_t idx, const char *name) const;
+
+    // rfcore::Listener
+    virtual void added(uint32_t idx, rfcore::Type, rfcore::State, int64_t stamp);
+    virtual void removed(uint32_t idx);
+    virtual void changed(uint32_t idx, rfcore::State, int64_t stamp);
+    virtual void warning(const char *msg, const rfkill_event&);
+
+private:
+    void openRF();
+    void onError();
+    void readRF();
+    std::string fetchName(uint32_t idx) const;
+
+    LiteDaemon(const LiteDaemon&);
+    LiteDaemon& operator=(const LiteDaemon&);
+};
+
+#endif // RFKILLD_H
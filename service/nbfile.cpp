@@ -26,14 +26,21 @@
 #include <errno.h>
 #include <string.h>
 #include <fcntl.h>
+#include <time.h>
 
 #include <QSocketNotifier>
 
 #include "nbfile.h"
 
-NBFile::NBFile(const char *s)
+NBFile::NBFile(const char *s, bool write)
+    :rw(write)
+    ,stamp(0)
 {
-    fd = ::open(s, O_RDONLY|O_NONBLOCK);
+    fd = ::open(s, (rw ? O_RDWR : O_RDONLY)|O_NONBLOCK);
+    if(fd==-1 && rw && (errno==EACCES || errno==EPERM)) {
+        rw = false;
+        fd = ::open(s, O_RDONLY|O_NONBLOCK);
+    }
     if(fd==-1) {
         std::ostringstream strm;
         strm<<"Failed to open "<<s<<": "<<strerror(errno);
@@ -61,6 +68,26 @@ QByteArray NBFile::read(quint64 s)
         strm<<"Failed to read: "<<strerror(errno);
         throw std::runtime_error(strm.str());
     }
+    stamp = now();
     ret.resize(n);
     return ret;
 }
+
+void NBFile::write(const QByteArray& buf)
+{
+    ssize_t n = ::write(fd, buf.constData(), buf.size());
+    if(n==-1) {
+        std::ostringstream strm;
+        strm<<"Failed to write: "<<strerror(errno);
+        throw std::runtime_error(strm.str());
+    } else if(n!=buf.size()) {
+        throw std::runtime_error("Short write");
+    }
+}
+
+qint64 NBFile::now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec)*1000000000 + ts.tv_nsec;
+}
@@ -25,13 +25,24 @@ class NBFile : public QObject
 {
     Q_OBJECT
     int fd;
+    bool rw;
+    qint64 stamp;
 public:
-    NBFile(const char *s);
+    //! When 'write' is requested, but not permitted, open read-only
+    NBFile(const char *s, bool write=false);
     virtual ~NBFile();
 
     int handle() const{return fd;}
+    bool canWrite() const{return rw;}
 
     QByteArray read(quint64);
+    void write(const QByteArray&);
+
+    //! CLOCK_MONOTONIC time (ns) when the last read() returned data
+    qint64 lastRead() const{return stamp;}
+
+    //! current CLOCK_MONOTONIC time (ns)
+    static qint64 now();
 
 signals:
     void readReady();
@@ -15,45 +15,27 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <QFile>
 #include <QDebug>
 
 #include "rfdevice.h"
+#include "rfmeta.h"
 
-static
-QString
-fetchName(quint32 idx)
-{
-    QString name(QString("/sys/class/rfkill/rfkill%1/name").arg(idx));
-
-    QFile fp(name);
-
-    QString ret;
-    if(fp.open(QFile::ReadOnly)) {
-        QByteArray arr(fp.readLine(100));
-        if(!arr.isEmpty()) {
-             ret = QString(arr).simplified();
-        }
-        fp.close();
-    }
-
-    if(ret.isNull())
-        ret = QString("<device:%1>").arg(idx);
-
-    return ret;
-}
-
-
-RFDevice::RFDevice(const QDBusConnection &c, Type t, quint32 id)
+RFDevice::RFDevice(const QDBusConnection &c, RFMetaCache &m, Type t, quint32 id, qint64 stamp)
     :QObject()
     ,id(id)
-    ,name(fetchName(id))
-    ,path(QString("/devices/%1").arg(name))
     ,type(t)
     ,cur(Invalid)
+    ,lastChange(stamp)
+    ,meta(&m)
     ,proxy(new Proxy(this))
     ,conn(c)
 {
+    // path from the same bytes as rfkilldaemon-lite uses
+    QByteArray raw(m.name(id));
+    name = QString::fromUtf8(raw);
+    path = QDBusObjectPath(QString::fromLatin1(
+                rfcore::objectPath(std::string(raw.constData(), raw.size()), id).c_str()));
+
     if(!conn.registerObject(path.path(), this))
         qWarning()<<"Failed to register "<<path.path();
 }
@@ -64,7 +46,7 @@ RFDevice::~RFDevice()
 }
 
 void
-RFDevice::setState(State s)
+RFDevice::setState(State s, qint64 stamp)
 {
     if(s==cur)
         return;
@@ -72,8 +54,13 @@ RFDevice::setState(State s)
          nowon = s==On,
          changed = cur!=s;
     cur=s;
-    if(changed)
+    lastChange=stamp;
+    // eg. hard_block_reasons may now differ
+    meta->invalidate(id);
+    if(changed) {
+        emit proxy->stateChangedAt(cur, lastChange);
         emit proxy->stateChanged(cur);
+    }
     if(wason ^ nowon)
         emit proxy->activeChanged(cur==On);
 }
@@ -85,6 +72,26 @@ RFDevice::Proxy::Proxy(RFDevice *s)
 
 RFDevice::Proxy::~Proxy() {}
 
+bool RFDevice::Proxy::persistent() const
+{
+    return self->meta->get(self->id).persistent;
+}
+
+QString RFDevice::Proxy::phy() const
+{
+    return self->meta->get(self->id).phy;
+}
+
+QString RFDevice::Proxy::driver() const
+{
+    return self->meta->get(self->id).driver;
+}
+
+uint RFDevice::Proxy::hardReasons() const
+{
+    return self->meta->get(self->id).hardReasons;
+}
+
 QStringList RFDevice::Proxy::typeNames()
 {
     QStringList ret;
@@ -25,25 +25,32 @@
 #include <QtDBus/QDBusAbstractAdaptor>
 #include <QtDBus/QDBusObjectPath>
 
+#include "rfcore.h"
+
+class RFMetaCache;
+
 class RFDevice : public QObject
 {
     Q_OBJECT
-
-    class Proxy;
 public:
-    enum State{Invalid=0,On,Soft,Hard};
-    enum Type{Wifi=0, Blue};
+    class Proxy;
+
+    enum State{Invalid=rfcore::Invalid,On=rfcore::On,Soft=rfcore::Soft,Hard=rfcore::Hard};
+    enum Type{Wifi=rfcore::Wifi, Blue=rfcore::Blue};
 
-    RFDevice(const QDBusConnection &, Type, quint32);
+    RFDevice(const QDBusConnection &, RFMetaCache &, Type, quint32, qint64 stamp);
     virtual ~RFDevice();
 
     quint32 id;
     QString name;
-    QDBusObjectPath path;
+    QDBusObjectPath path; // see rfcore::objectPath()
     Type type;
     State cur;
+    qint64 lastChange; // CLOCK_MONOTONIC ns of the event which set 'cur'
+
+    RFMetaCache *meta;
 
-    void setState(State s);
+    void setState(State s, qint64 stamp);
 
     QScopedPointer<Proxy> proxy;
     QDBusConnection conn;
@@ -57,6 +64,11 @@ class RFDevice::Proxy : public QDBusAbstractAdaptor
     Q_PROPERTY(int type READ type)
     Q_PROPERTY(bool active READ active NOTIFY activeChanged)
     Q_PROPERTY(int state READ state NOTIFY stateChanged)
+    Q_PROPERTY(qlonglong lastChangeTime READ lastChangeTime)
+    Q_PROPERTY(bool persistent READ persistent)
+    Q_PROPERTY(QString phy READ phy)
+    Q_PROPERTY(QString driver READ driver)
+    Q_PROPERTY(uint hardReasons READ hardReasons)
 
     friend class RFDevice;
 public:
@@ -67,6 +79,12 @@ public:
     bool active() const{return self->cur==RFDevice::On;}
     int type() const{return self->type;}
     int state() const{return self->cur;}
+    qlonglong lastChangeTime() const{return self->lastChange;}
+    // loaded from sysfs on demand
+    bool persistent() const;
+    QString phy() const;
+    QString driver() const;
+    uint hardReasons() const;
 
 public slots:
     static QStringList typeNames();
@@ -75,6 +93,8 @@ public slots:
 signals:
     void activeChanged(bool);
     void stateChanged(int);
+    //! also gives CLOCK_MONOTONIC time (ns) when the event was read
+    void stateChangedAt(int, qlonglong);
 
 private:
     RFDevice *self;
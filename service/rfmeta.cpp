@@ -0,0 +1,107 @@
+/* RF Kill monitor
+ * Copyright 2015 Michael Davidsaver <mdavidsaver@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QDebug>
+
+#include "rfmeta.h"
+#include "rfsysfs.h"
+#include "rfcore.h"
+
+RFMetaCache::RFMetaCache(const RFSysfs& s, QObject *par)
+    :QObject(par)
+    ,nLoads(0)
+    ,sysfs(s)
+{
+    idle.setSingleShot(true);
+    connect(&idle, SIGNAL(timeout()), SLOT(loadPending()));
+}
+
+RFMetaCache::~RFMetaCache() {}
+
+QByteArray RFMetaCache::name(quint32 idx) const
+{
+    QByteArray arr(sysfs.attr(idx, "name"));
+    std::string ret(rfcore::deviceName(std::string(arr.constData(), arr.size()), idx));
+    return QByteArray(ret.data(), ret.size());
+}
+
+const RFMetaCache::Info& RFMetaCache::get(quint32 idx)
+{
+    Info& info = cache[idx];
+    if(!info.loaded)
+        load(idx, info);
+    return info;
+}
+
+void RFMetaCache::queue(quint32 idx)
+{
+    pending.append(idx);
+    if(!idle.isActive())
+        idle.start(0);
+}
+
+void RFMetaCache::invalidate(quint32 idx)
+{
+    QHash<quint32, Info>::iterator it = cache.find(idx);
+    if(it!=cache.end())
+        it->loaded = false;
+}
+
+void RFMetaCache::forget(quint32 idx)
+{
+    cache.remove(idx);
+    pending.removeAll(idx);
+}
+
+void RFMetaCache::loadPending()
+{
+    QList<quint32> todo;
+    todo.swap(pending);
+
+    foreach(quint32 idx, todo) {
+        get(idx);
+    }
+}
+
+void RFMetaCache::load(quint32 idx, Info& info)
+{
+    nLoads++;
+
+    info.persistent = sysfs.attr(idx, "persistent").toUInt()!=0;
+    // For cfg80211 and bluetooth, rfkillN/device is phyN or hciN,
+    // whose own 'device' is the bus device with the driver.
+    // For platform drivers (thinkpad_acpi, ideapad, ...) rfkillN/device
+    // is the platform device, and has the driver itself.
+    QByteArray parent(sysfs.link(idx, "device"));
+    if(rfcore::isPhyName(parent.constData()))
+        info.phy = QString(parent);
+    else
+        info.phy.clear();
+
+    info.driver.clear();
+    QByteArray path("device");
+    for(unsigned depth=0; depth<4 && info.driver.isEmpty(); depth++) {
+        QByteArray drv(sysfs.link(idx, (path+"/driver").constData()));
+        if(!drv.isNull())
+            info.driver = QString(drv);
+        path += "/device";
+    }
+    // added in Linux 5.11.  Formatted as hex, eg. "0x1"
+    info.hardReasons = sysfs.attr(idx, "hard_block_reasons").toUInt(0, 0);
+
+    info.loaded = true;
+}
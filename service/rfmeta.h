@@ -0,0 +1,75 @@
+/* RF Kill monitor
+ * Copyright 2015 Michael Davidsaver <mdavidsaver@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef RFMETA_H
+#define RFMETA_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QTimer>
+
+class RFSysfs;
+
+//! Cache of sysfs attributes of rfkill devices, keyed by index.
+//! Entries are loaded on first access, or in a batch once
+//! the event loop is idle.
+class RFMetaCache : public QObject
+{
+    Q_OBJECT
+public:
+    struct Info {
+        Info() :loaded(false), persistent(false), hardReasons(0) {}
+        bool loaded;
+        bool persistent;
+        QString phy;    // phyN or hciN.  Empty for platform devices
+        QString driver; // first driver found walking up from rfkillN/device
+        quint32 hardReasons; // RFKILL_HARD_BLOCK_*
+    };
+
+    RFMetaCache(const RFSysfs&, QObject *par=0);
+    virtual ~RFMetaCache();
+
+    //! Read the device name, as from rfcore::deviceName() (UTF-8).
+    //! Not cached as it is only needed once.
+    QByteArray name(quint32 idx) const;
+
+    //! Fetch attributes, loading now if needed
+    const Info& get(quint32 idx);
+
+    //! Load attributes later
+    void queue(quint32 idx);
+    //! Re-load attributes on next access (eg. after a state change)
+    void invalidate(quint32 idx);
+    //! Drop attributes of a removed device
+    void forget(quint32 idx);
+
+    quint64 nLoads;
+
+private slots:
+    void loadPending();
+
+private:
+    void load(quint32 idx, Info&);
+
+    const RFSysfs& sysfs;
+    QHash<quint32, Info> cache;
+    QList<quint32> pending;
+    QTimer idle;
+};
+
+#endif // RFMETA_H
@@ -0,0 +1,205 @@
+/* RF Kill monitor
+ * Copyright 2015 Michael Davidsaver <mdavidsaver@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <QFile>
+#include <QDir>
+#include <QStringList>
+#include <QRegExp>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include "rfpolicy.h"
+#include "rfcore.h"
+
+namespace {
+const char * const opNames[] = {
+    "add", "del", "change", "changeall",
+};
+const char * const stateNames[] = {
+    "invalid", "on", "soft", "hard",
+};
+
+// index of name in list, or -1
+int lookup(const QString& name, const char * const *names, unsigned N)
+{
+    for(unsigned i=0; i<N; i++) {
+        if(name==names[i])
+            return i;
+    }
+    return -1;
+}
+
+#define LOOKUP(NAME, LIST) lookup(NAME, LIST, sizeof(LIST)/sizeof(LIST[0]))
+
+const unsigned ntypes = rfcore::NKernelTypes;
+}
+
+RFPolicy::RFPolicy()
+    :table(ntypes*4*4)
+{}
+
+QString RFPolicy::defaultFile()
+{
+    QString base(qgetenv("XDG_CONFIG_HOME"));
+    if(base.isEmpty())
+        base = QDir::homePath()+"/.config";
+    return base+"/rfkilltray/rules";
+}
+
+bool RFPolicy::load(const QString& fname)
+{
+    QFile fp(fname);
+    if(!fp.exists()) {
+        rules.clear();
+        table.fill(QList<int>());
+        return true;
+    }
+    if(!fp.open(QFile::ReadOnly)) {
+        qWarning()<<"Failed to open "<<fname<<", keeping current rules";
+        return false;
+    }
+
+    QList<Rule> next;
+    QVector<QList<int> > ntable(table.size());
+
+    for(int line=1; !fp.atEnd(); line++) {
+        QString raw(fp.readLine());
+        int hash = raw.indexOf('#');
+        if(hash>=0)
+            raw.truncate(hash);
+
+        QStringList parts(raw.split(QRegExp("\\s+"), QString::SkipEmptyParts));
+        if(parts.isEmpty())
+            continue;
+
+        int type=-1, op=-1, state=-1;
+        Rule rule;
+        rule.line = line;
+        rule.target = RFKILL_TYPE_ALL;
+        rule.nMatch = 0;
+        rule.totalNs = rule.maxNs = 0;
+
+        bool ok = parts.size()>=5 && parts[3]=="=>";
+        if(ok) {
+            type = rfcore::kernelType(parts[0].toLatin1().constData());
+            op = parts[1]=="any" ? 4 : LOOKUP(parts[1], opNames);
+            state = parts[2]=="any" ? 4 : LOOKUP(parts[2], stateNames);
+            ok = type>=0 && op>=0 && state>0;
+        }
+        if(ok && parts[4]=="restore" && parts.size()==5) {
+            rule.action = Restore;
+        } else if(ok && (parts[4]=="block" || parts[4]=="unblock") && parts.size()==6) {
+            rule.action = parts[4]=="block" ? Block : Unblock;
+            int target = rfcore::kernelType(parts[5].toLatin1().constData());
+            ok = target>=0;
+            rule.target = rfkill_type(target);
+        } else {
+            ok = false;
+        }
+
+        if(!ok) {
+            qWarning()<<fname<<":"<<line<<" invalid rule, keeping current rules";
+            return false;
+        }
+
+        int ridx = next.size();
+        next.append(rule);
+
+        // expand wildcards now so that evaluate() is a single lookup
+        for(unsigned t=0; t<ntypes; t++) {
+            if(type!=0 && int(t)!=type)
+                continue;
+            for(unsigned o=0; o<4; o++) {
+                if(op!=4 && int(o)!=op)
+                    continue;
+                for(unsigned s=1; s<4; s++) {
+                    if(state!=4 && int(s)!=state)
+                        continue;
+                    ntable[index(t, o, s)].append(ridx);
+                }
+            }
+        }
+    }
+
+    rules.swap(next);
+    table.swap(ntable);
+    qDebug()<<"Loaded "<<rules.size()<<" rules from "<<fname;
+    return true;
+}
+
+void RFPolicy::evaluate(const rfkill_event& evt, const QString& name, write_map& out)
+{
+    if(evt.type>=ntypes || evt.op>=4)
+        return;
+    unsigned state = evt.hard ? 3 : evt.soft ? 2 : 1;
+
+    const QList<int>& matched = table[index(evt.type, evt.op, state)];
+
+    foreach(int ridx, matched) {
+        Rule& rule = rules[ridx];
+        QElapsedTimer T;
+        T.start();
+
+        rfkill_event W;
+        memset(&W, 0, sizeof(W));
+        bool act = true;
+
+        switch(rule.action) {
+        case Block:
+        case Unblock:
+            W.op = RFKILL_OP_CHANGE_ALL;
+            W.type = rule.target;
+            W.soft = rule.action==Block;
+            break;
+        case Restore: {
+            QHash<QString, bool>::const_iterator it = saved.constFind(name);
+            if(name.isEmpty() || it==saved.constEnd()) {
+                act = false; // never seen
+                break;
+            }
+            W.op = RFKILL_OP_CHANGE;
+            W.idx = evt.idx;
+            W.type = evt.type;
+            W.soft = it.value();
+        }
+            break;
+        }
+
+        if(act) {
+            quint32 key = W.op==RFKILL_OP_CHANGE ? W.idx : W.type;
+            out[qMakePair(quint8(W.op), key)] = W;
+        }
+
+        qint64 ns = T.nsecsElapsed();
+        rule.nMatch++;
+        rule.totalNs += ns;
+        rule.maxNs = qMax(rule.maxNs, ns);
+    }
+}
+
+void RFPolicy::stats(QVariantMap& ret) const
+{
+    ret["rules"] = rules.size();
+    foreach(const Rule& rule, rules) {
+        QString pre(QString("rule:%1:").arg(rule.line));
+        ret[pre+"matches"] = rule.nMatch;
+        ret[pre+"ns"] = rule.totalNs;
+        ret[pre+"maxNs"] = rule.maxNs;
+    }
+}
@@ -0,0 +1,96 @@
+/* RF Kill monitor
+ * Copyright 2015 Michael Davidsaver <mdavidsaver@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef RFPOLICY_H
+#define RFPOLICY_H
+
+#include <linux/rfkill.h>
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include <QVariantMap>
+
+//! Rules which react to rfkill events by changing soft block state.
+//!
+//! Rules file has one rule per line.  '#' starts a comment.
+//!
+//!   <type> <op> <state> => block|unblock <type>
+//!   <type> <op> <state> => restore
+//!
+//! type  : all wlan bluetooth uwb wimax wwan gps fm nfc
+//! op    : add del change changeall any
+//! state : on soft hard any   (state of the device after the event)
+//!
+//! In a trigger 'all' matches any type.  'restore' sets the soft state
+//! of the triggering device to what it was when a device of the same
+//! name was last seen.  eg.
+//!
+//!   wlan change hard => block bluetooth
+//!   bluetooth add any => restore
+class RFPolicy
+{
+public:
+    //! Pending writes.  Keyed by (op, idx or type) so that a later
+    //! request for the same target replaces an earlier one.
+    typedef QMap<QPair<quint8,quint32>, rfkill_event> write_map;
+
+    RFPolicy();
+
+    //! $XDG_CONFIG_HOME/rfkilltray/rules
+    static QString defaultFile();
+
+    //! Replace current rules.  A missing file is not an error,
+    //! and leaves no rules.  Returns false, and keeps the current
+    //! rules, if the file can't be read or has errors.
+    bool load(const QString& fname);
+
+    bool empty() const{return rules.isEmpty();}
+
+    //! Evaluate rules for one event, which has already been applied.
+    //! 'name' is the name of the device, if known.
+    void evaluate(const rfkill_event&, const QString& name, write_map& out);
+
+    //! Note current soft state of a device for later 'restore'
+    void remember(const QString& name, bool soft) {saved[name] = soft;}
+
+    void stats(QVariantMap&) const;
+
+private:
+    enum Action {Block, Unblock, Restore};
+    struct Rule {
+        int line;
+        Action action;
+        rfkill_type target;
+
+        quint64 nMatch;
+        qint64 totalNs, maxNs;
+    };
+
+    static int index(unsigned type, unsigned op, unsigned state)
+    { return (type*4 + op)*4 + state; }
+
+    QList<Rule> rules;
+    //! rules to evaluate, indexed by index(type, op, state)
+    QVector<QList<int> > table;
+
+    QHash<QString, bool> saved;
+};
+
+#endif // RFPOLICY_H
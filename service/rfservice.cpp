@@ -19,25 +19,57 @@
 #include <algorithm>
 #include <stdexcept>
 
+#include <string.h>
+
 #include <linux/rfkill.h>
 
 #include <QDebug>
+#include <QSet>
+#include <QtAlgorithms>
 
 #include "rfservice.h"
 #include "rfdevice.h"
 
 #define DEVRFKILL "/dev/rfkill"
 
+// sysfs audit period (ms).  Starts short after an error
+// and backs off while the device list stays consistent.
+#define AUDIT_MIN 2000
+#define AUDIT_MAX (10*60*1000)
+
+// period (ms) of attempts to re-open /dev/rfkill after an error.
+// Also the longest audit period while it is closed.
+#define RETRY_PERIOD 60000
+
+// Rules writing in this many consecutive batches are assumed
+// to be triggering each other.
+#define RULE_CHAIN_MAX 8
+
 RFManager::RFManager(const QDBusConnection &c, QObject *par)
     :QObject(par)
+    ,table(*this)
     ,proxy(new Proxy(this))
+    ,meta(sysfs)
+    ,auditInterval(AUDIT_MIN)
+    ,nAudits(0)
+    ,nAuditFixes(0)
+    ,ruleChain(0)
+    ,nRuleWrites(0)
+    ,nRuleLoops(0)
     ,conn(c)
 {
+    policy.load(RFPolicy::defaultFile());
+
     connect(&retry, SIGNAL(timeout()), SLOT(retryNow()));
+    connect(&auditTimer, SIGNAL(timeout()), SLOT(auditNow()));
 
     retry.setSingleShot(true);
     retry.start(1000);
 
+    auditTimer.setSingleShot(true);
+    if(sysfs.isOpen())
+        auditTimer.start(auditInterval);
+
     if(!conn.registerObject("/service", this))
         throw std::runtime_error("Failed to register main DBus object");
 }
@@ -47,22 +79,6 @@ RFManager::~RFManager()
     conn.unregisterObject("/service");
 }
 
-namespace {
-bool operator==(const RFDevice&d, rfkill_type t)
-{
-    if(t==RFKILL_TYPE_ALL)
-        return true;
-    switch(d.type) {
-    case RFDevice::Wifi: return t==RFKILL_TYPE_WLAN;
-    case RFDevice::Blue: return t==RFKILL_TYPE_BLUETOOTH;
-    }
-    return false;
-}
-
-bool operator!=(const RFDevice&d, rfkill_type t)
-{ return !(d==t); }
-}
-
 QDebug& operator<<(QDebug& dbg, const rfkill_event& evt)
 {
     dbg << "IDX: " << evt.idx << "Type: " << evt.type << " Op:" << evt.op
@@ -71,101 +87,85 @@ QDebug& operator<<(QDebug& dbg, const rfkill_event& evt)
 }
 
 static
-void setDevState(RFDevice& dev, const rfkill_event& evt)
-{
-    if(evt.hard)
-        dev.setState(RFDevice::Hard);
-    else if(evt.soft)
-        dev.setState(RFDevice::Soft);
-    else
-        dev.setState(RFDevice::On);
-}
-
-union punEvent {
-    rfkill_event evt;
-    char bytes[sizeof(rfkill_event)];
-};
-
-static
-void processEvent(RFManager& self, const rfkill_event& evt, bool& addrem)
+void processEvent(RFManager& self, const rfkill_event& evt, qint64 stamp, bool& addrem)
 {
     qDebug()<<"Event "<<evt;
 
-    switch(rfkill_operation(evt.op)) {
-    case RFKILL_OP_CHANGE_ALL:{
-        // change all devices of the given type
-        foreach (const RFManager::device_pointer& dev, self.devices) {
-            if(*dev!=rfkill_type(evt.type))
-                continue;
-
-            setDevState(*dev, evt);
-        }
-    }return;
-
-    case RFKILL_OP_ADD:{
-        // add a new device
-        RFDevice::Type dt;
-        switch(rfkill_type(evt.type)) {
-        case RFKILL_TYPE_WLAN: dt=RFDevice::Wifi; break;
-        case RFKILL_TYPE_BLUETOOTH: dt=RFDevice::Blue; break;
-        default:
-            qWarning()<<"Asked to add device of unsupported type "<<evt.idx;
-            return; // ignore device type
-        }
-
-        RFManager::device_pointer ptr(new RFDevice(self.conn, dt, evt.idx));
-        setDevState(*ptr, evt);
-        self.devices.insert(evt.idx, ptr);
+    if(self.table.process(evt, stamp))
         addrem = true;
+}
 
-    }return;
-
-    case RFKILL_OP_DEL:{
-        RFManager::device_map::iterator it=self.devices.find(evt.idx);
-        if(it==self.devices.end()) {
-            qWarning()<<"Asked to remove unknown device of type "<<evt.idx;
-        } else {
-            self.devices.erase(it);
-            addrem = true;
-        }
-    }return;
-
-    case RFKILL_OP_CHANGE:{
-        RFManager::device_map::iterator it=self.devices.find(evt.idx);
-        if(it==self.devices.end()) {
-            qWarning()<<"Asked to change unknown device "<<evt.idx;
-        } else {
-            setDevState(**it, evt);
-        }
-    }return;
+void RFManager::added(uint32_t idx, rfcore::Type t, rfcore::State s, int64_t stamp)
+{
+    device_pointer ptr(new RFDevice(conn, meta, RFDevice::Type(t), idx, stamp));
+    ptr->setState(RFDevice::State(s), stamp);
+    devices.insert(idx, ptr);
+    devicesByName.insert(ptr->name, ptr);
+    // attributes other than name are loaded once the burst of ADDs is done
+    meta.queue(idx);
+}
 
-    // default: omitted to trigger compiler warning if rkill_operation enum is extended
+void RFManager::removed(uint32_t idx)
+{
+    device_pointer ptr(devices.take(idx));
+    if(ptr) {
+        devicesByName.remove(ptr->name, ptr);
     }
+    meta.forget(idx);
+}
 
-    qWarning()<<"Unknown operator "<<evt.op;
+void RFManager::changed(uint32_t idx, rfcore::State s, int64_t stamp)
+{
+    device_map::iterator it = devices.find(idx);
+    if(it!=devices.end())
+        (*it)->setState(RFDevice::State(s), stamp);
+}
+
+void RFManager::warning(const char *msg, const rfkill_event& evt)
+{
+    qWarning()<<msg<<" "<<evt;
 }
 
 void RFManager::readReady()
 {
     qDebug()<<"Readable ";
+    readBatch();
+}
+
+bool RFManager::readBatch()
+{
     QByteArray buf(fd->read(10*sizeof(rfkill_event)));
     qDebug()<<"Read "<<buf.size();
-    if(buf.size()%sizeof(rfkill_event)!=0) {
+    std::vector<rfkill_event> events;
+    if(!rfcore::decode(buf.constData(), buf.size(), events)) {
         qWarning("Read returned partial event?");
         onError();
-        return;
+        return false;
     }
-    QByteArray::const_iterator it=buf.begin(), end=buf.end();
 
     bool addrem = false;
+    QList<rfkill_event> batch;
 
-    for(;it!=end;it+=sizeof(rfkill_event))
+    for(size_t i=0; i<events.size(); i++)
     {
-        Q_ASSERT(it<end);
-        punEvent evtbuf;
-        std::copy(it, it+sizeof(rfkill_event), evtbuf.bytes);
+        const rfkill_event& evt = events[i];
         try{
-            processEvent(*this, evtbuf.evt, addrem);
+            // Opening /dev/rfkill replays an ADD for every device.
+            // Rules see those for known devices only as the change,
+            // if any, made while closed.
+            rfcore::Table::entries_t::const_iterator prev = table.entries.find(evt.idx);
+            bool replay = evt.op==RFKILL_OP_ADD && prev!=table.entries.end();
+            rfcore::State before = replay ? prev->second.state : rfcore::Invalid;
+
+            processEvent(*this, evt, fd->lastRead(), addrem);
+
+            if(!replay) {
+                batch.append(evt);
+            } else if(rfcore::eventState(evt)!=before) {
+                rfkill_event chg(evt);
+                chg.op = RFKILL_OP_CHANGE;
+                batch.append(chg);
+            }
         }catch(std::exception& e){
             qWarning("Exception processing event: %s", e.what());
         }
@@ -173,13 +173,107 @@ void RFManager::readReady()
 
     if(addrem)
         emit proxy->adaptersChanged();
+
+    if(!batch.isEmpty())
+        daemonLatency.add(NBFile::now()-fd->lastRead());
+
+    runPolicy(batch);
+
+    return !buf.isEmpty();
+}
+
+void RFManager::runPolicy(const QList<rfkill_event>& batch)
+{
+    if(policy.empty() || batch.isEmpty())
+        return;
+    try{
+        applyPolicy(batch);
+    }catch(std::exception& e){
+        qWarning("Exception applying rules: %s", e.what());
+    }
+}
+
+// would writing this not change anything?
+static
+bool noop(const RFDevice& dev, const rfkill_event& W)
+{
+    // soft state is hidden while hard blocked
+    return dev.cur!=RFDevice::Hard && (dev.cur==RFDevice::Soft)==bool(W.soft);
+}
+
+void RFManager::applyPolicy(const QList<rfkill_event>& batch)
+{
+    RFPolicy::write_map writes;
+
+    foreach(const rfkill_event& evt, batch) {
+        device_map::const_iterator it = devices.find(evt.idx);
+        QString name;
+        if(it!=devices.end() && evt.op!=RFKILL_OP_CHANGE_ALL)
+            name = (*it)->name;
+
+        policy.evaluate(evt, name, writes);
+
+        // after evaluation so that 'restore' sees the previous state
+        if(!name.isEmpty() && !evt.hard && (evt.op==RFKILL_OP_ADD || evt.op==RFKILL_OP_CHANGE))
+            policy.remember(name, evt.soft);
+    }
+
+    // drop writes which would change nothing, which also ends most chains
+    for(RFPolicy::write_map::iterator it=writes.begin(); it!=writes.end();) {
+        const rfkill_event& W = it.value();
+        bool skip = true;
+        rfcore::Type tracked;
+
+        if(W.op==RFKILL_OP_CHANGE) {
+            device_map::const_iterator dit = devices.find(W.idx);
+            skip = dit==devices.end() || noop(**dit, W);
+        } else if(W.type!=RFKILL_TYPE_ALL && !rfcore::mapType(W.type, tracked)) {
+            skip = false; // devices of this type aren't tracked, so can't tell
+        } else {
+            foreach(const RFManager::device_pointer& dev, devices) {
+                if(rfcore::typeMatches(rfcore::Type(dev->type), W.type) && !noop(*dev, W)) {
+                    skip = false;
+                    break;
+                }
+            }
+        }
+
+        if(skip)
+            it = writes.erase(it);
+        else
+            ++it;
+    }
+
+    if(writes.isEmpty()) {
+        ruleChain = 0;
+        return;
+    } else if(!fd || !fd->canWrite()) {
+        // nothing is written, so this can't start a chain
+        qWarning("Rules matched, but " DEVRFKILL " is not writable");
+        ruleChain = 0;
+        return;
+    } else if(++ruleChain > RULE_CHAIN_MAX) {
+        qWarning("Rules appear to be triggering each other.  Dropping %d writes", writes.size());
+        nRuleLoops++;
+        ruleChain = 0;
+        return;
+    }
+
+    // The kernel takes one event per write(), so this is one write
+    // per distinct target.  A type wide block is a single CHANGE_ALL.
+    foreach(const rfkill_event& W, writes) {
+        qDebug()<<"Rule writes "<<W;
+        fd->write(QByteArray(reinterpret_cast<const char*>(&W), sizeof(W)));
+        nRuleWrites++;
+    }
 }
 
 void RFManager::retryNow()
 {
     qDebug("Opening now");
 try{
-    QScopedPointer<NBFile> file(new NBFile(DEVRFKILL));
+    // rules need to write
+    QScopedPointer<NBFile> file(new NBFile(DEVRFKILL, !policy.empty()));
 
     connect(file.data(), SIGNAL(readReady()), SLOT(readReady()));
 
@@ -194,7 +288,142 @@ try{
 void RFManager::onError()
 {
     fd.reset();
-    retry.start(60000);
+    retry.start(RETRY_PERIOD);
+
+    // we may miss events until re-opened, so check sysfs soon
+    auditInterval = AUDIT_MIN;
+    if(sysfs.isOpen())
+        auditTimer.start(auditInterval);
+}
+
+unsigned RFManager::audit()
+{
+    if(!sysfs.isOpen())
+        return 0;
+
+    // process anything already queued so that we don't
+    // "discover" events which are in flight.
+    try{
+        while(fd && readBatch()) {}
+    }catch(std::exception& e){
+        qWarning("Exception reading before audit: %s", e.what());
+        onError();
+    }
+
+    nAudits++;
+
+    QList<quint32> present(sysfs.indices());
+    qint64 stamp = NBFile::now();
+    QSet<quint32> seen;
+    unsigned nfix = 0;
+    bool addrem = false;
+    QList<rfkill_event> synth; // as if read, for rules
+
+    foreach(quint32 idx, present) {
+        rfkill_event evt;
+        if(!sysfs.event(idx, evt))
+            continue;
+
+        rfcore::Type type;
+        if(!rfcore::mapType(evt.type, type))
+            continue; // processEvent() would ignore anyway
+        seen.insert(idx);
+
+        device_map::const_iterator it = devices.find(idx);
+        if(it!=devices.end()) {
+            const RFDevice& dev = **it;
+            if(dev.type!=RFDevice::Type(type)
+                    || QString::fromUtf8(meta.name(idx))!=dev.name) {
+                // not the device we think it is
+                qWarning()<<"Audit: replace device "<<idx;
+                evt.op = RFKILL_OP_DEL;
+                processEvent(*this, evt, stamp, addrem);
+                synth.append(evt);
+
+            } else if(dev.cur!=RFDevice::State(rfcore::eventState(evt))) {
+                qWarning()<<"Audit: missed change of "<<idx;
+                evt.op = RFKILL_OP_CHANGE;
+                processEvent(*this, evt, stamp, addrem);
+                synth.append(evt);
+                nfix++;
+                continue;
+
+            } else {
+                continue; // consistent
+            }
+        } else {
+            qWarning()<<"Audit: missed add of "<<idx;
+        }
+
+        evt.op = RFKILL_OP_ADD;
+        processEvent(*this, evt, stamp, addrem);
+        synth.append(evt);
+        nfix++;
+    }
+
+    QList<quint32> gone;
+    for(device_map::const_iterator it=devices.begin(), end=devices.end(); it!=end; ++it) {
+        if(!seen.contains(it.key()))
+            gone.append(it.key());
+    }
+
+    foreach(quint32 idx, gone) {
+        qWarning()<<"Audit: missed remove of "<<idx;
+        rfkill_event evt;
+        memset(&evt, 0, sizeof(evt));
+        evt.idx = idx;
+        evt.op = RFKILL_OP_DEL;
+        processEvent(*this, evt, stamp, addrem);
+        synth.append(evt);
+        nfix++;
+    }
+
+    if(addrem)
+        emit proxy->adaptersChanged();
+
+    runPolicy(synth);
+
+    nAuditFixes += nfix;
+    return nfix;
+}
+
+void RFManager::auditNow()
+{
+    unsigned nfix = 0;
+    try{
+        nfix = audit();
+    }catch(std::exception& e){
+        qWarning("Exception during audit: %s", e.what());
+        nfix = 1;
+    }
+
+    if(nfix)
+        auditInterval = AUDIT_MIN;
+    else if(!fd)
+        // events are missed until re-opened, but scanning
+        // more often than we retry gains little
+        auditInterval = qMin(2*auditInterval, RETRY_PERIOD);
+    else
+        auditInterval = qMin(2*auditInterval, AUDIT_MAX);
+
+    auditTimer.start(auditInterval);
+}
+
+// keys <prefix>:count, :maxNs, :le<2**i> for each non-empty bucket,
+// and :overflow for the last bucket
+static
+void latencyStats(QVariantMap& ret, const QString& prefix, const rfcore::LatencyHist& H)
+{
+    ret[prefix+":count"] = quint64(H.count);
+    ret[prefix+":maxNs"] = qint64(H.maxNs);
+    for(unsigned i=0; i<H.N; i++) {
+        if(!H.buckets[i])
+            continue;
+        else if(i==H.N-1)
+            ret[prefix+":overflow"] = quint64(H.buckets[i]);
+        else
+            ret[QString("%1:le%2").arg(prefix).arg(qint64(1)<<i)] = quint64(H.buckets[i]);
+    }
 }
 
 RFManager::Proxy::Proxy(RFManager *s)
@@ -207,9 +436,94 @@ RFManager::Proxy::~Proxy() {}
 QList<QDBusObjectPath>
 RFManager::Proxy::adapters() const
 {
+    // 'devices' is a hash, so put in a stable order
+    QList<quint32> idxs(self->devices.keys());
+    qSort(idxs);
+
     QList<QDBusObjectPath> ret;
-    foreach (const RFManager::device_pointer& dev, self->devices) {
+    foreach (quint32 idx, idxs) {
+        ret.append(self->devices.value(idx)->path);
+    }
+    return ret;
+}
+
+QList<QDBusObjectPath>
+RFManager::Proxy::find(const QString& name) const
+{
+    QList<QDBusObjectPath> ret;
+    foreach (const RFManager::device_pointer& dev, self->findName(name)) {
         ret.append(dev->path);
     }
     return ret;
 }
+
+QVariantMap
+RFManager::Proxy::describe() const
+{
+    QStringList tnames(RFDevice::Proxy::typeNames());
+
+    QVariantMap ret;
+    foreach (const RFManager::device_pointer& dev, self->devices) {
+        QVariantMap info;
+        info["name"] = dev->name;
+        info["type"] = int(dev->type);
+        info["typeName"] = tnames.value(dev->type);
+        info["state"] = int(dev->cur);
+        info["lastChange"] = dev->lastChange;
+        ret[dev->path.path()] = info;
+    }
+    return ret;
+}
+
+unsigned
+RFManager::Proxy::audit()
+{
+    unsigned nfix = 0;
+    try{
+        nfix = self->audit();
+    }catch(std::exception& e){
+        qWarning("Exception during audit: %s", e.what());
+        nfix = 1;
+    }
+    if(nfix) {
+        // something was wrong, so look again soon
+        self->auditInterval = AUDIT_MIN;
+        self->auditTimer.start(self->auditInterval);
+    }
+    return nfix;
+}
+
+void
+RFManager::Proxy::reportLatency(qlonglong ns)
+{
+    self->deliveryLatency.add(ns);
+}
+
+bool
+RFManager::Proxy::reloadRules()
+{
+    bool ok = self->policy.load(RFPolicy::defaultFile());
+    if(!self->policy.empty() && self->fd && !self->fd->canWrite()) {
+        // re-open for writing
+        self->fd.reset();
+        self->retryNow();
+    }
+    return ok;
+}
+
+QVariantMap
+RFManager::Proxy::stats() const
+{
+    QVariantMap ret;
+    ret["audits"] = self->nAudits;
+    ret["auditFixes"] = self->nAuditFixes;
+    ret["auditInterval"] = self->auditInterval;
+    ret["metaLoads"] = self->meta.nLoads;
+    ret["ruleWrites"] = self->nRuleWrites;
+    ret["ruleLoops"] = self->nRuleLoops;
+    latencyStats(ret, "daemonLatency", self->daemonLatency);
+    latencyStats(ret, "deliveryLatency", self->deliveryLatency);
+    self->policy.stats(ret);
+    ret["open"] = !self->fd.isNull();
+    return ret;
+}
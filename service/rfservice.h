@@ -19,21 +19,28 @@
 
 #include <QList>
 #include <QMap>
+#include <QHash>
+#include <QMultiHash>
 #include <QScopedPointer>
 #include <QSharedPointer>
 #include <QSocketNotifier>
 #include <QTimer>
 #include <QFile>
+#include <QVariantMap>
 
 #include <QtDBus/QDBusConnection>
 #include <QtDBus/QDBusAbstractAdaptor>
 #include <QtDBus/QDBusObjectPath>
 
 #include "nbfile.h"
+#include "rfsysfs.h"
+#include "rfmeta.h"
+#include "rfpolicy.h"
+#include "rfcore.h"
 
 class RFDevice;
 
-class RFManager : public QObject
+class RFManager : public QObject, public rfcore::Listener
 {
     Q_OBJECT
     class Proxy;
@@ -41,21 +48,61 @@ public:
     RFManager(const QDBusConnection&, QObject *par=0);
     virtual ~RFManager();
 
+    //! state of all devices.  'devices' follows this
+    rfcore::Table table;
+
     typedef QSharedPointer<RFDevice> device_pointer;
-    typedef QMap<quint32,device_pointer> device_map;
+    typedef QHash<quint32,device_pointer> device_map;
     device_map devices;
+    //! index of 'devices', maintained by added() and removed().
+    //! (QtDBus already dispatches by object path)
+    QMultiHash<QString,device_pointer> devicesByName;
+
+    //! All devices with this name
+    QList<device_pointer> findName(const QString& name) const{return devicesByName.values(name);}
 
     QScopedPointer<Proxy> proxy;
 
     QTimer retry;
     QScopedPointer<NBFile> fd;
 
+    //! compare devices with sysfs and synthesize any missed events.
+    //! Returns the number of discrepancies corrected.
+    unsigned audit();
+
+    RFSysfs sysfs;
+    RFMetaCache meta;
+    QTimer auditTimer;
+    int auditInterval; // ms
+
+    quint64 nAudits, nAuditFixes;
+
+    RFPolicy policy;
+    unsigned ruleChain; // consecutive batches which caused rule writes
+    quint64 nRuleWrites, nRuleLoops;
+
+    // from read() of an event, until its signals are queued
+    rfcore::LatencyHist daemonLatency;
+    // reported by clients, from read() until signal received
+    rfcore::LatencyHist deliveryLatency;
+
     QDBusConnection conn;
+    // rfcore::Listener
+    virtual void added(uint32_t idx, rfcore::Type, rfcore::State, int64_t stamp);
+    virtual void removed(uint32_t idx);
+    virtual void changed(uint32_t idx, rfcore::State, int64_t stamp);
+    virtual void warning(const char *msg, const rfkill_event&);
+
 private:
     void onError();
+    bool readBatch();
+    //! applyPolicy(), if there are rules, catching any exception
+    void runPolicy(const QList<rfkill_event>&);
+    void applyPolicy(const QList<rfkill_event>&);
 private slots:
     void readReady();
     void retryNow();
+    void auditNow();
 };
 
 class RFManager::Proxy : public QDBusAbstractAdaptor
@@ -67,8 +114,21 @@ public:
     Proxy(RFManager*);
     virtual ~Proxy();
 public slots:
-    int version() const{return 1;}
+    int version() const{return 4;}
+    //! Object paths of all adapters, ordered by kernel index
     QList<QDBusObjectPath> adapters() const;
+    //! Object paths of adapters with this name.  Added in version 4.
+    QList<QDBusObjectPath> find(const QString& name) const;
+    //! Current state of all adapters, keyed by object path.
+    //! Each entry has name, type, typeName, state, and lastChange.
+    //! Added in version 2.
+    QVariantMap describe() const;
+    unsigned audit();
+    bool reloadRules();
+    //! Clients report the delay from lastChangeTime until they
+    //! received stateChangedAt.  Added in version 3.
+    Q_NOREPLY void reportLatency(qlonglong ns);
+    QVariantMap stats() const;
 
 signals:
     void adaptersChanged();
@@ -0,0 +1,134 @@
+/* RF Kill monitor
+ * Copyright 2015 Michael Davidsaver <mdavidsaver@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+
+#include <linux/rfkill.h>
+
+#include <QDebug>
+
+#include "rfsysfs.h"
+#include "rfcore.h"
+
+RFSysfs::RFSysfs(const char *base)
+{
+    dirfd = ::open(base, O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+    if(dirfd==-1)
+        qWarning("Failed to open %s: %s", base, strerror(errno));
+}
+
+RFSysfs::~RFSysfs()
+{
+    if(dirfd!=-1)
+        ::close(dirfd);
+}
+
+QList<quint32> RFSysfs::indices() const
+{
+    QList<quint32> ret;
+    if(dirfd==-1)
+        return ret;
+
+    // fdopendir() takes ownership, so give it a copy
+    int dfd = ::dup(dirfd);
+    if(dfd==-1)
+        return ret;
+    DIR *dir = ::fdopendir(dfd);
+    if(!dir) {
+        ::close(dfd);
+        return ret;
+    }
+    ::rewinddir(dir);
+
+    struct dirent *ent;
+    while((ent=::readdir(dir))!=NULL) {
+        unsigned idx;
+        char junk;
+        if(sscanf(ent->d_name, "rfkill%u%c", &idx, &junk)==1)
+            ret.append(idx);
+    }
+
+    ::closedir(dir);
+    return ret;
+}
+
+QByteArray RFSysfs::attr(quint32 idx, const char *name) const
+{
+    if(dirfd==-1)
+        return QByteArray();
+
+    char path[64];
+    snprintf(path, sizeof(path), "rfkill%u/%s", (unsigned)idx, name);
+
+    int fd = ::openat(dirfd, path, O_RDONLY|O_CLOEXEC);
+    if(fd==-1)
+        return QByteArray();
+
+    char buf[128];
+    ssize_t n = ::pread(fd, buf, sizeof(buf), 0);
+    ::close(fd);
+
+    if(n<=0)
+        return QByteArray();
+    return QByteArray(buf, n).trimmed();
+}
+
+QByteArray RFSysfs::link(quint32 idx, const char *name) const
+{
+    if(dirfd==-1)
+        return QByteArray();
+
+    char path[64];
+    snprintf(path, sizeof(path), "rfkill%u/%s", (unsigned)idx, name);
+
+    char buf[256];
+    ssize_t n = ::readlinkat(dirfd, path, buf, sizeof(buf));
+    if(n<=0 || size_t(n)==sizeof(buf))
+        return QByteArray();
+
+    QByteArray ret(buf, n);
+    int sep = ret.lastIndexOf('/');
+    if(sep>=0)
+        ret = ret.mid(sep+1);
+    return ret;
+}
+
+bool RFSysfs::event(quint32 idx, rfkill_event& evt) const
+{
+    QByteArray type(attr(idx, "type")),
+               soft(attr(idx, "soft")),
+               hard(attr(idx, "hard"));
+    if(type.isNull() || soft.isNull() || hard.isNull())
+        return false;
+
+    int t = rfcore::kernelType(type.constData());
+    if(t<0)
+        return false;
+
+    evt.idx = idx;
+    evt.type = t;
+    evt.soft = soft.toUInt()!=0;
+    evt.hard = hard.toUInt()!=0;
+    return true;
+}
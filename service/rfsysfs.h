@@ -0,0 +1,58 @@
+/* RF Kill monitor
+ * Copyright 2015 Michael Davidsaver <mdavidsaver@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef RFSYSFS_H
+#define RFSYSFS_H
+
+#include <QList>
+#include <QByteArray>
+
+struct rfkill_event;
+
+//! Access to /sys/class/rfkill through a held directory handle.
+//! Attributes are opened relative to this handle, so no path
+//! lookup from the root is done for each read.
+class RFSysfs
+{
+    int dirfd;
+public:
+    RFSysfs(const char *base = "/sys/class/rfkill");
+    ~RFSysfs();
+
+    bool isOpen() const{return dirfd!=-1;}
+
+    //! indices of all rfkill devices currently present
+    QList<quint32> indices() const;
+
+    //! Read attribute file 'rfkill<idx>/<name>' with whitespace trimmed.
+    //! Returns a null array if the attribute can't be read.
+    QByteArray attr(quint32 idx, const char *name) const;
+
+    //! Last component of the target of symlink 'rfkill<idx>/<name>'.
+    //! Returns a null array if there is no such link.
+    QByteArray link(quint32 idx, const char *name) const;
+
+    //! Fill in idx, type, soft, and hard of an event from current sysfs state.
+    //! op is left for the caller.  Returns false if the device is gone
+    //! or of a type we don't know.
+    bool event(quint32 idx, rfkill_event& evt) const;
+
+private:
+    RFSysfs(const RFSysfs&);
+    RFSysfs& operator=(const RFSysfs&);
+};
+
+#endif // RFSYSFS_H
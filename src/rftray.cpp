@@ -15,159 +15,265 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <stdexcept>
-
 #include <QDebug>
-#include <QSignalMapper>
 #include <QSettings>
 #include <QApplication>
+#include <QPair>
 
 #include "rftray.h"
 
 namespace {
-template<typename T>
-T syncFetch(QDBusPendingReply<T> R)
-{
-    R.waitForFinished();
-    if(R.isError()) {
-        qDebug()<<"DBus error: "<<R.error();
-        throw std::runtime_error("DBus error");
-    }
-    return R.value();
-}
+const char * const iconFiles[4] = {
+    ":/icon/error.svg",
+    ":/icon/green.svg",
+    ":/icon/yellow.svg",
+    ":/icon/red.svg",
+};
+
+// common panel icon sizes
+const int iconSizes[] = {16, 22, 24, 32, 48};
 }
 
 RFTray::RFTray(const QDBusConnection& c,QWidget *parent)
     :QWidget(parent)
+    ,curStatus(Error)
+    ,sized(false)
     ,conn(c)
-    ,device(NULL)
 {
     QSettings settings("rfkilltray", "gui");
     deviceName = settings.value("interface").toString();
+    aggregate = settings.value("aggregate", false).toBool();
 
     retry.setSingleShot(true);
 
-    connect(&retry, SIGNAL(timeout()), SLOT(adaptersChanged()));
+    connect(&retry, SIGNAL(timeout()), SLOT(refresh()));
 
-    service = new FooRfkillServiceInterface("foo.rfkill",
-                                            "/service",
-                                            conn, this);
-    service->setTimeout(5000);
+    // the model follows adapter add/remove itself
+    model = new RFModel(conn, this);
+    model->reportLatency = true;
+    connect(model, SIGNAL(changed()), SLOT(modelChanged()));
+    connect(model, SIGNAL(error(QString)), SLOT(modelError(QString)));
+
+    menu = new QMenu(this);
+    menu->addAction("Adapters");
+    menu->addSeparator();
+    allAct = menu->addAction("All adapters", this, SLOT(setAggregate()));
+    allAct->setCheckable(true);
+    adaptersEnd = menu->addSeparator();
+    menu->addAction("E&xit", QApplication::instance(), SLOT(quit()));
+
+    mapper = new QSignalMapper(this);
+    connect(mapper, SIGNAL(mapped(QString)), SLOT(setAdapter(QString)));
 
-    connect(service, SIGNAL(adaptersChanged()), SLOT(adaptersChanged()));
+    renderIcons(QSize());
 
-    systray.setContextMenu(new QMenu(this));
-    systray.setIcon(QIcon(":/icon/error.svg"));
-    systray.setToolTip("Starting up");
+    systray.setContextMenu(menu);
+    systray.setIcon(icons[curStatus]);
+    curTip = "Starting up";
+    systray.setToolTip(curTip);
 
     systray.show();
 
     retry.start(1000);
 }
 
-RFTray::~RFTray()
+RFTray::~RFTray() {}
+
+void RFTray::refresh()
 {
-    delete service;
+    checkSize();
+    model->refreshAsync();
 }
 
-void RFTray::adaptersChanged()
+void RFTray::modelError(const QString& msg)
 {
-try{
-    QString wantname(deviceName);
-    qDebug()<<"Want device "<<wantname;
+    qWarning("Error while fetching adapter list: %s", msg.toLocal8Bit().constData());
+    onError();
+}
 
-    int ver(syncFetch(service->version()));
-    qDebug()<<"Remote is version "<<ver;
+void RFTray::onError()
+{
+    retry.start(60000);
 
-    QList<QDBusObjectPath> paths(syncFetch(service->adapters()));
-    QScopedPointer<foo::rfkill::device> take;
-    QStringList names;
+    updateMenu(QMap<QString, QString>(), QString());
+    setStatus(Error, "Error");
 
-    foreach(const QDBusObjectPath& path, paths)
-    {
-        QScopedPointer<foo::rfkill::device> dev;
-        dev.reset(new foo::rfkill::device("foo.rfkill", path.path(),
-                                          conn, this));
-
-        QString name(dev->name());
-        qDebug()<<"Consider "<<name;
-        names.append(name);
-
-        if(wantname.isEmpty() || name==wantname)
-        {
-            take.swap(dev);
-            wantname.swap(name);
+    qDebug()<<"Will retry";
+}
+
+void RFTray::renderIcons(const QSize& extra)
+{
+    for(unsigned i=0; i<4; i++) {
+        QIcon svg(iconFiles[i]);
+        QIcon& icon = icons[i];
+
+        if(icon.isNull()) {
+            for(unsigned j=0; j<sizeof(iconSizes)/sizeof(iconSizes[0]); j++)
+                icon.addPixmap(svg.pixmap(iconSizes[j], iconSizes[j]));
         }
+        if(extra.isValid() && !icon.availableSizes().contains(extra))
+            icon.addPixmap(svg.pixmap(extra));
     }
+}
 
-    // build menu
-    QMenu *ctxt = new QMenu(this);
-    ctxt->addAction("Adapters");
-    ctxt->addSeparator();
-
-    QSignalMapper *mapper = new QSignalMapper(ctxt);
-    connect(mapper, SIGNAL(mapped(QString)), SLOT(setAdapter(QString)));
+void RFTray::checkSize()
+{
+    if(sized)
+        return;
+    // empty until the panel has embedded us, which happens
+    // some time after show()
+    QSize actual(systray.geometry().size());
+    if(actual.isEmpty())
+        return;
+    sized = true;
+    renderIcons(actual);
+    systray.setIcon(icons[curStatus]);
+}
 
-    foreach(const QString& name, names)
-    {
-        QAction *act = ctxt->addAction(name, mapper, SLOT(map()));
-        act->setCheckable(true);
-        act->setChecked(name==wantname);
-        mapper->setMapping(act, name);
+void RFTray::setStatus(Status s, const QString& tip)
+{
+    if(s!=curStatus) {
+        curStatus = s;
+        systray.setIcon(icons[curStatus]);
     }
+    if(tip!=curTip) {
+        curTip = tip;
+        systray.setToolTip(curTip);
+    }
+}
 
-    ctxt->addSeparator();
-    ctxt->addAction("E&xit", QApplication::instance(), SLOT(quit()));
-
-    systray.contextMenu()->deleteLater();
-    systray.setContextMenu(ctxt);
+void RFTray::updateMenu(const QMap<QString, QString>& labels, const QString& checked)
+{
+    // remove entries for adapters which are gone
+    for(QMap<QString, QAction*>::iterator it=adapterActs.begin(); it!=adapterActs.end();) {
+        if(labels.contains(it.key())) {
+            ++it;
+            continue;
+        }
+        mapper->removeMappings(it.value());
+        menu->removeAction(it.value());
+        delete it.value();
+        it = adapterActs.erase(it);
+    }
 
-    if(!take.isNull())
+    for(QMap<QString, QString>::const_iterator it=labels.begin(), end=labels.end(); it!=end; ++it)
     {
-        device.swap(take);
-        deviceName.swap(wantname);
-
-        connect(device.data(), SIGNAL(activeChanged(bool)), SLOT(activeChanged(bool)));
-        activeChanged(device->active());
+        const QString& path = it.key();
+        QAction *&act = adapterActs[path];
+        if(!act) {
+            act = new QAction(it.value(), menu);
+            act->setCheckable(true);
+            connect(act, SIGNAL(triggered()), mapper, SLOT(map()));
+            mapper->setMapping(act, path);
+            menu->insertAction(adaptersEnd, act);
+        } else if(act->text()!=it.value()) {
+            act->setText(it.value()); // another of the same name came or went
+        }
+        if(act->isChecked()!=(path==checked))
+            act->setChecked(path==checked);
     }
-}catch(std::exception& e){
-    qWarning("Exception while fetching adapter list: %s", e.what());
-    onError();
-}
 }
 
-void RFTray::onError()
+void RFTray::setAdapter(QString path)
 {
-    retry.start(60000);
-
-    QMenu *ctxt = new QMenu(this);
-    ctxt->addAction("E&xit", QApplication::instance(), SLOT(quit()));
-
-    systray.contextMenu()->deleteLater();
-    systray.setContextMenu(ctxt);
-
-    systray.setIcon(QIcon(":/icon/error.svg"));
-    systray.setToolTip("Error");
-
-    qDebug()<<"Will retry";
+    QSettings settings("rfkilltray", "gui");
+    devicePath = path;
+    const RFModel::Device *dev = model->findPath(path);
+    if(dev)
+        deviceName = dev->name;
+    aggregate = false;
+    settings.setValue("interface", deviceName);
+    settings.setValue("aggregate", aggregate);
+    modelChanged();
 }
 
-void RFTray::setAdapter(QString name)
+void RFTray::setAggregate()
 {
     QSettings settings("rfkilltray", "gui");
-    deviceName = name;
-    settings.setValue("interface", deviceName);
-    retry.stop();
-    adaptersChanged();
+    aggregate = true;
+    settings.setValue("aggregate", aggregate);
+    modelChanged();
 }
 
-void RFTray::activeChanged(bool b)
+void RFTray::modelChanged()
 {
-    if(b) {
-        systray.setIcon(QIcon(":/icon/green.svg"));
-        systray.setToolTip(QString("%1 is active").arg(deviceName));
-    } else {
-        systray.setIcon(QIcon(":/icon/red.svg"));
-        systray.setToolTip(QString("%1 is blocked").arg(deviceName));
+    if(!model->valid)
+        return;
+    checkSize();
+
+    const RFModel::Device *sel = NULL;
+    if(!aggregate) {
+        sel = model->findPath(devicePath);
+        if(!sel && !deviceName.isEmpty())
+            sel = model->findName(deviceName); // eg. re-plugged with a new index
+        else if(!sel && !model->devices.isEmpty())
+            sel = &model->devices.begin().value();
+        if(sel)
+            devicePath = sel->path;
+    }
+
+    updateMenu(model->labels(), sel ? sel->path : QString());
+    allAct->setChecked(aggregate);
+
+    if(model->devices.isEmpty()) {
+        setStatus(Error, "No adapters");
+        return;
+
+    } else if(!aggregate) {
+        if(!sel)
+            setStatus(Error, QString("%1 not present").arg(deviceName));
+        else if(sel->active())
+            setStatus(Active, QString("%1 is active").arg(sel->name));
+        else
+            setStatus(Blocked, QString("%1 is blocked").arg(sel->name));
+        return;
+    }
+
+    // per type count of active, and total
+    QMap<QString, QPair<int,int> > bytype;
+    QStringList blocked;
+    bool anysoft = false, anyhard = false;
+    int nactive = 0;
+
+    foreach(const RFModel::Device& dev, model->devices)
+    {
+        QPair<int,int>& cnt = bytype[dev.typeName];
+        cnt.second++;
+        switch(dev.state) {
+        case RFModel::On:
+            cnt.first++;
+            nactive++;
+            break;
+        case RFModel::Hard:
+            anyhard = true;
+            blocked.append(QString("%1 (hard)").arg(dev.name));
+            break;
+        case RFModel::Soft:
+            anysoft = true;
+            blocked.append(QString("%1 (soft)").arg(dev.name));
+            break;
+        default:
+            break; // state not known yet
+        }
+    }
+
+    QStringList lines;
+    for(QMap<QString, QPair<int,int> >::const_iterator it=bytype.begin(), end=bytype.end(); it!=end; ++it)
+    {
+        lines.append(QString("%1: %2 of %3 active").arg(it.key())
+                     .arg(it.value().first).arg(it.value().second));
     }
+    if(!blocked.isEmpty())
+        lines.append(QString("Blocked: %1").arg(blocked.join(", ")));
+
+    Status S;
+    if(anyhard || (anysoft && nactive==0))
+        S = Blocked;
+    else if(anysoft)
+        S = Partial;
+    else if(nactive)
+        S = Active;
+    else
+        S = Error; // no adapter state known
+    setStatus(S, lines.join("\n"));
 }
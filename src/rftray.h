@@ -22,12 +22,13 @@
 
 #include <QSystemTrayIcon>
 #include <QMenu>
+#include <QMap>
+#include <QIcon>
+#include <QSignalMapper>
+#include <QTimer>
 #include <QtDBus/QDBusConnection>
-#include <QtDBus/QDBusAbstractInterface>
-#include <QtDBus/QDBusObjectPath>
 
-#include "serviceinterface.h"
-#include "deviceinterface.h"
+#include "rfmodel.h"
 
 class RFTray : public QWidget
 {
@@ -36,20 +37,50 @@ public:
     explicit RFTray(const QDBusConnection&, QWidget *parent = 0);
     virtual ~RFTray();
 
+    enum Status {Error=0, Active, Partial, Blocked};
+
     QSystemTrayIcon systray;
+    QIcon icons[4]; // indexed by Status
+    Status curStatus;
+    bool sized; // icons include the size the panel gave us
+    QString curTip;
+
+    QMenu *menu;
+    QAction *allAct;
+    QAction *adaptersEnd; // adapter entries are inserted before this
+    QSignalMapper *mapper;
+    QMap<QString, QAction*> adapterActs; // keyed by object path
+
     QDBusConnection conn;
     QTimer retry;
 
-    ::foo::rfkill::service *service;
-    QScopedPointer<foo::rfkill::device> device;
-    QString deviceName;
+    RFModel *model;
+    // selected adapter.  The path is not saved, as the kernel index
+    // in it changes when the adapter is re-plugged.  So fall back to
+    // the saved name when the path is gone.
+    QString devicePath, deviceName;
+
+    // when true, show the combined state of all adapters
+    bool aggregate;
 
     void onError();
 
+    //! (re)render all icons, including the given size if valid
+    void renderIcons(const QSize& extra);
+    //! once the tray is embedded, render icons at its actual size
+    void checkSize();
+    //! update icon and tooltip, if changed
+    void setStatus(Status, const QString&);
+    //! add/remove/check adapter menu entries to match.
+    //! 'labels' and 'checked' are keyed by object path
+    void updateMenu(const QMap<QString, QString>& labels, const QString& checked);
+
 private slots:
-    void adaptersChanged();
-    void activeChanged(bool);
+    void refresh();
+    void modelChanged();
+    void modelError(const QString&);
     void setAdapter(QString);
+    void setAggregate();
 };
 
 #endif // RFTRAY_H